@@ -0,0 +1,95 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+import esphome.final_validate as fv
+from esphome.components import binary_sensor
+from esphome.const import (
+    CONF_COUNT,
+    CONF_NAME,
+    CONF_TYPE,
+    CONF_WINDOW_SIZE,
+    DEVICE_CLASS_OCCUPANCY,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    ICON_TIMER,
+    STATE_CLASS_MEASUREMENT,
+    UNIT_MILLISECOND,
+)
+
+from .sensor import LTRAlsPsComponent, has_ps, ltr_sensor_schema, new_ltr_sensor
+
+CONF_LTR_ALS_PS_ID = "ltr_als_ps_id"
+CONF_ENTER_THRESHOLD = "enter_threshold"
+CONF_EXIT_THRESHOLD = "exit_threshold"
+CONF_MIN_DWELL = "min_dwell"
+CONF_LATENCY = "latency"
+
+
+def validate_presence(config):
+    if config[CONF_EXIT_THRESHOLD] >= config[CONF_ENTER_THRESHOLD]:
+        raise cv.Invalid(
+            f"{CONF_EXIT_THRESHOLD} shall be less than {CONF_ENTER_THRESHOLD}"
+        )
+    if config[CONF_COUNT] > config[CONF_WINDOW_SIZE]:
+        raise cv.Invalid(f"{CONF_COUNT} shall not exceed {CONF_WINDOW_SIZE}")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
+    binary_sensor.binary_sensor_schema(device_class=DEVICE_CLASS_OCCUPANCY).extend(
+        {
+            cv.GenerateID(CONF_LTR_ALS_PS_ID): cv.use_id(LTRAlsPsComponent),
+            cv.Required(CONF_ENTER_THRESHOLD): cv.int_range(min=1, max=0x7FF),
+            cv.Required(CONF_EXIT_THRESHOLD): cv.int_range(min=0, max=0x7FE),
+            cv.Optional(CONF_COUNT, default=2): cv.int_range(min=1, max=16),
+            cv.Optional(CONF_WINDOW_SIZE, default=3): cv.int_range(min=1, max=16),
+            cv.Optional(
+                CONF_MIN_DWELL, default="0ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_LATENCY): cv.maybe_simple_value(
+                ltr_sensor_schema(
+                    unit_of_measurement=UNIT_MILLISECOND,
+                    icon=ICON_TIMER,
+                    accuracy_decimals=0,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                ),
+                key=CONF_NAME,
+            ),
+        }
+    ),
+    validate_presence,
+)
+
+
+def final_validate_parent_type(config):
+    full_config = fv.full_config.get()
+    path = full_config.get_path_for_id(config[CONF_LTR_ALS_PS_ID])[:-1]
+    parent_config = full_config.get_config_for_path(path)
+    if not has_ps(parent_config):
+        raise cv.Invalid(
+            f"Presence needs proximity, {parent_config[CONF_TYPE]} sensor has none",
+            path=[CONF_LTR_ALS_PS_ID],
+        )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = final_validate_parent_type
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_LTR_ALS_PS_ID])
+    var = await binary_sensor.new_binary_sensor(config)
+
+    cg.add_define("USE_LTR_PS_PRESENCE")
+    cg.add(parent.set_presence_binary_sensor(var))
+    cg.add(
+        parent.set_presence(
+            config[CONF_ENTER_THRESHOLD],
+            config[CONF_EXIT_THRESHOLD],
+            config[CONF_COUNT],
+            config[CONF_WINDOW_SIZE],
+            config[CONF_MIN_DWELL],
+        )
+    )
+    if latency_config := config.get(CONF_LATENCY):
+        sens = await new_ltr_sensor(parent, latency_config)
+        cg.add(parent.set_presence_latency_sensor(sens))
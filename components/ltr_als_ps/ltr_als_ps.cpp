@@ -3,6 +3,9 @@
 #include "esphome/core/log.h"
 #include "esphome/core/helpers.h"
 
+#include <algorithm>
+#include <cstdio>
+
 using esphome::i2c::ErrorCode;
 
 namespace esphome {
@@ -11,37 +14,15 @@ namespace ltr_als_ps {
 static const char *const TAG = "ltr_als_ps";
 
 static const uint8_t MAX_TRIES = 5;
-
-template<typename T, size_t size> T get_next(const T (&array)[size], const T val) {
-  size_t i = 0;
-  size_t idx = -1;
-  while (idx == -1 && i < size) {
-    if (array[i] == val) {
-      idx = i;
-      break;
-    }
-    i++;
-  }
-  if (idx == -1 || i + 1 >= size)
-    return val;
-  return array[i + 1];
-}
-
-template<typename T, size_t size> T get_prev(const T (&array)[size], const T val) {
-  size_t i = size - 1;
-  size_t idx = -1;
-  while (idx == -1 && i > 0) {
-    if (array[i] == val) {
-      idx = i;
-      break;
-    }
-    i--;
-  }
-  if (idx == -1 || i == 0)
-    return val;
-  return array[i - 1];
-}
-
+static const uint8_t ALS_WAKEUP_TIME_MS = 10;  // from standby, as per datasheet
+static const uint8_t MIN_POLL_INTERVAL_MS = 10;
+#ifdef USE_LTR_PS_CALIBRATION
+static const uint16_t PS_OFFSET_MAX = 0x3ff;  // 10 bit
+static const uint8_t PS_CALIBRATION_SAMPLES = 16;
+#endif
+static const uint8_t MAX_POLLS_PER_ROUND = 4;
+
+#ifdef USE_LTR_ALS
 static uint16_t get_itime_ms(IntegrationTime time) {
   static const uint16_t ALS_INT_TIME[8] = {100, 50, 200, 400, 150, 250, 300, 350};
   return ALS_INT_TIME[time & 0b111];
@@ -57,13 +38,130 @@ static float get_gain_coeff(AlsGain gain) {
   return ALS_GAIN[gain & 0b111];
 }
 
+static uint8_t get_gain_index(AlsGain gain) {
+  // GAIN_48 and GAIN_96 follow the gap in register values
+  return gain < GAIN_48 ? gain : gain - 2;
+}
+#endif
+
+#ifdef USE_LTR_PS
+static uint16_t get_ps_meas_time_ms(PsMeasurementRate rate) {
+  static const uint16_t PS_MEAS_RATE[16] = {50, 70, 100, 200, 500, 1000, 2000, 2000, 10, 10, 10, 10, 10, 10, 10, 10};
+  return PS_MEAS_RATE[rate & 0b1111];
+}
+
 static float get_ps_gain_coeff(PsGain gain) {
   static const float PS_GAIN[4] = {16, 0, 32, 64};
   return PS_GAIN[gain & 0b11];
 }
 
+static uint8_t get_ps_led_current_ma(PsLedCurrent current) {
+  static const uint8_t PS_LED_CURRENT[8] = {5, 10, 20, 50, 100, 100, 100, 100};
+  return PS_LED_CURRENT[current & 0b111];
+}
+
+static uint8_t get_ps_led_freq_khz(PsLedFreq freq) { return 30 + 10 * (freq & 0b111); }
+
+static uint8_t get_ps_led_duty_percent(PsLedDuty duty) { return 25 * ((duty & 0b11) + 1); }
+
+static uint16_t decode_ps_data(uint8_t ps_low, uint8_t ps_high_raw) {
+  PsData1Register ps_high;
+  ps_high.raw = ps_high_raw;
+  if (ps_high.ps_saturation_flag) {
+    return 0x7ff;  // full 11 bit range
+  }
+  return encode_uint16(ps_high.ps_data_high, ps_low);
+}
+#endif
+
+LTRBusScheduler *LTRBusScheduler::get_for_bus(i2c::I2CBus *bus) {
+  static std::vector<LTRBusScheduler *> schedulers;
+  for (auto *scheduler : schedulers) {
+    if (scheduler->bus_ == bus)
+      return scheduler;
+  }
+  auto *scheduler = new LTRBusScheduler(bus);  // NOLINT(cppcoreguidelines-owning-memory)
+  schedulers.push_back(scheduler);
+  return scheduler;
+}
+
+uint8_t LTRBusScheduler::add_member() {
+  this->last_round_.push_back(0);
+  return this->last_round_.size() - 1;
+}
+
+bool LTRBusScheduler::try_poll(uint8_t slot) {
+  uint8_t members = this->size();
+  if (members <= MAX_POLLS_PER_ROUND)
+    return true;
+
+  if (this->last_round_[slot] == this->round_) {
+    // Same member asks again - everybody had their chance, next loop() round begins
+    this->round_++;
+    this->cursor_ = (this->cursor_ + MAX_POLLS_PER_ROUND) % members;
+  }
+  this->last_round_[slot] = this->round_;
+  return (slot + members - this->cursor_) % members < MAX_POLLS_PER_ROUND;
+}
+
+uint32_t LTRBusScheduler::get_start_delay(uint8_t slot, uint32_t frame_ms) const {
+  if (this->size() <= 1 || frame_ms == 0)
+    return 0;
+  // Align cycle start to the member's own slot within the frame
+  uint32_t slot_start = frame_ms * slot / this->size();
+  return (slot_start + frame_ms - millis() % frame_ms) % frame_ms;
+}
+
 void LTRAlsPsComponent::setup() {
   ESP_LOGCONFIG(TAG, "Setting up LTR-303/329");
+  this->setup_time_ms_ = millis();
+  this->bus_scheduler_ = LTRBusScheduler::get_for_bus(this->shared_bus_ != nullptr ? this->shared_bus_ : this->bus_);
+  this->bus_slot_ = this->bus_scheduler_->add_member();
+#ifdef USE_LTR_ALS
+  this->prepare_lux_scale_table_();
+  this->als_readings_.gain = this->gain_;
+  this->als_readings_.integration_time = this->integration_time_;
+  if (this->automatic_mode_enabled_) {
+    this->restore_als_range_();
+  }
+#endif
+#ifdef USE_LTR_PS_CALIBRATION
+  if (this->ps_calibration_.enabled) {
+    this->restore_ps_offset_();
+  }
+#endif
+#ifdef USE_LTR_PS_LED_CONTROL
+  // levels at 1 pulse for every current up to configured one, then more pulses at configured current.
+  // Start at full drive - the safe side, controller goes down from there.
+  this->ps_led_control_.levels_count =
+      std::min<uint8_t>(this->ps_led_current_, PsLedCurrent::PS_LED_CURRENT_100MA) + this->ps_pulses_;
+  this->ps_led_control_.level = this->ps_led_control_.levels_count - 1;
+#endif
+#ifdef USE_LTR_PS_PRESENCE
+  if (this->is_ps_presence_()) {
+    this->presence_binary_sensor_->publish_initial_state(false);
+  }
+#endif
+#ifdef USE_LTR_ADAPTIVE_SAMPLING
+  if (this->is_adaptive_sampling_()) {
+    this->adaptive_.base_repeat_rate = this->repeat_rate_;
+    this->set_update_interval(clamp(this->get_update_interval(), this->adaptive_.min_interval_ms,
+                                    this->adaptive_.max_interval_ms));
+  }
+#endif
+#ifdef USE_LTR_PS_STREAMING
+  if (this->is_ps_() && this->is_ps_streaming_() && get_ps_meas_time_ms(this->ps_measurement_rate_) < 20) {
+    // default loop() pace is ~16ms, that's not enough to catch every sample
+    this->high_freq_.start();
+  }
+#endif
+  if (this->interrupt_pin_ != nullptr) {
+    this->interrupt_pin_->setup();
+    this->interrupt_pin_->attach_interrupt(LTRAlsPsComponent::gpio_intr, this, gpio::INTERRUPT_FALLING_EDGE);
+  }
+#ifdef USE_LTR_DIAGNOSTICS
+  this->set_interval("diagnostics", 60 * 1000, [this]() { this->publish_diagnostics_(); });
+#endif
   // As per datasheet we need to wait at least 100ms after power on to get ALS chip responsive
   this->set_timeout(100, [this]() { this->state_ = State::DELAYED_SETUP; });
 }
@@ -83,23 +181,126 @@ void LTRAlsPsComponent::dump_config() {
   };
 
   LOG_I2C_DEVICE(this);
+  ESP_LOGCONFIG(TAG, "  Detected part: %s", this->part_name_ != nullptr ? this->part_name_ : "unknown");
   ESP_LOGCONFIG(TAG, "  Device type: %s", get_device_type(this->ltr_type_));
+#ifdef USE_LTR_ALS
   ESP_LOGCONFIG(TAG, "  Automatic mode: %s", ONOFF(this->automatic_mode_enabled_));
   ESP_LOGCONFIG(TAG, "  Gain: %.0fx", get_gain_coeff(this->gain_));
   ESP_LOGCONFIG(TAG, "  Integration time: %d ms", get_itime_ms(this->integration_time_));
   ESP_LOGCONFIG(TAG, "  Measurement repeat rate: %d ms", get_meas_time_ms(this->repeat_rate_));
   ESP_LOGCONFIG(TAG, "  Glass attenuation factor: %f", this->glass_attenuation_factor_);
+  ESP_LOGCONFIG(TAG, "  Lux calculation: %s", this->float_lux_reference_ ? "floating point (reference)" : "fixed point");
+#endif
+#ifdef USE_LTR_TRACE
+  ESP_LOGCONFIG(TAG, "  Raw sample trace: %s", ONOFF(this->trace_));
+#endif
+#ifdef USE_LTR_ALS_STANDBY
+  ESP_LOGCONFIG(TAG, "  Standby between polls: %s", ONOFF(this->als_standby_));
+  LOG_SENSOR("  ", "Estimated active time", this->als_active_time_sensor_);
+#endif
+#ifdef USE_LTR_ADAPTIVE_SAMPLING
+  if (this->is_adaptive_sampling_()) {
+    ESP_LOGCONFIG(TAG, "  Adaptive sampling: %u..%u ms, change threshold %.0f%%", this->adaptive_.min_interval_ms,
+                  this->adaptive_.max_interval_ms, this->adaptive_.change_threshold * 100.0f);
+  }
+#endif
+#ifdef USE_LTR_PS
   ESP_LOGCONFIG(TAG, "  Proximity gain: %.0fx", get_ps_gain_coeff(this->ps_gain_));
+  ESP_LOGCONFIG(TAG, "  Proximity measurement rate: %d ms", get_ps_meas_time_ms(this->ps_measurement_rate_));
   ESP_LOGCONFIG(TAG, "  Proximity cooldown time: %d s", this->ps_cooldown_time_s_);
   ESP_LOGCONFIG(TAG, "  Proximity high threshold: %d", this->ps_threshold_high_);
   ESP_LOGCONFIG(TAG, "  Proximity low threshold: %d", this->ps_threshold_low_);
+  ESP_LOGCONFIG(TAG, "  Proximity LED: %u mA, %u%% duty, %u kHz, %u pulses", get_ps_led_current_ma(this->ps_led_current_),
+                get_ps_led_duty_percent(this->ps_led_duty_), get_ps_led_freq_khz(this->ps_led_freq_), this->ps_pulses_);
+#endif
+#ifdef USE_LTR_PS_PRESENCE
+  LOG_BINARY_SENSOR("  ", "Presence", this->presence_binary_sensor_);
+  if (this->presence_binary_sensor_ != nullptr) {
+    ESP_LOGCONFIG(TAG, "    Enter above %u, exit below %u, %u of %u samples, min dwell %u ms",
+                  this->presence_.enter_threshold, this->presence_.exit_threshold, this->presence_.count,
+                  this->presence_.window, this->presence_.min_dwell_ms);
+  }
+  LOG_SENSOR("  ", "Presence latency", this->presence_latency_sensor_);
+#endif
+#ifdef USE_LTR_PS_LED_CONTROL
+  if (this->ps_led_control_.enabled) {
+    ESP_LOGCONFIG(TAG, "  Proximity LED control: %u levels, %.3f..%.3f uC per sample", this->ps_led_control_.levels_count,
+                  this->ps_led_charge_uc_(0), this->ps_led_charge_uc_(this->ps_led_control_.levels_count - 1));
+  }
+  LOG_SENSOR("  ", "Proximity LED charge", this->ps_led_charge_sensor_);
+#endif
+#ifdef USE_LTR_PS_CALIBRATION
+  if (this->ps_calibration_.enabled) {
+    ESP_LOGCONFIG(TAG, "  Proximity offset: %u (margin %u, tracking every %u s)", this->ps_calibration_.offset,
+                  this->ps_calibration_.margin, this->ps_calibration_.tracking_interval_ms / 1000);
+  }
+#endif
+#ifdef USE_LTR_ALS
+  if (this->is_als_report_on_change_()) {
+    if (this->als_window_lux_ > 0.0f) {
+      ESP_LOGCONFIG(TAG, "  Report on change: %.1f lx", this->als_window_lux_);
+    } else {
+      ESP_LOGCONFIG(TAG, "  Report on change: %.0f%%", this->als_window_percent_ * 100.0f);
+    }
+    ESP_LOGCONFIG(TAG, "  ALS interrupt persistence: %d", this->als_interrupt_persistence_);
+  }
+#endif
+  LOG_PIN("  Interrupt pin: ", this->interrupt_pin_);
+#ifdef USE_LTR_PS
+  if (this->is_ps_interrupt_mode_()) {
+    ESP_LOGCONFIG(TAG, "  Proximity interrupt persistence: %d", this->ps_interrupt_persistence_);
+  }
+#endif
 
+  ESP_LOGCONFIG(TAG, "  Bus slot: %d of %d", this->bus_slot_ + 1, this->bus_scheduler_->size());
   LOG_UPDATE_INTERVAL(this);
 
+#ifdef USE_LTR_ALS
   LOG_SENSOR("  ", "ALS calculated lux", this->ambient_light_sensor_);
   LOG_SENSOR("  ", "CH1 Infrared counts", this->infrared_counts_sensor_);
   LOG_SENSOR("  ", "CH0 Visible+IR counts", this->full_spectrum_counts_sensor_);
   LOG_SENSOR("  ", "Actual gain", this->actual_gain_sensor_);
+  LOG_SENSOR("  ", "Actual integration time", this->actual_integration_time_sensor_);
+#endif
+#ifdef USE_LTR_DIAGNOSTICS
+  LOG_SENSOR("  ", "I2C transactions", this->i2c_transactions_sensor_);
+  LOG_SENSOR("  ", "I2C errors", this->i2c_errors_sensor_);
+  LOG_SENSOR("  ", "Max loop time", this->max_loop_time_sensor_);
+#ifdef USE_LTR_ALS
+  LOG_SENSOR("  ", "Auto-range settle time", this->settle_time_sensor_);
+  LOG_SENSOR("  ", "Data timeouts", this->data_timeouts_sensor_);
+  LOG_SENSOR("  ", "Bad data", this->bad_data_sensor_);
+  LOG_SENSOR("  ", "Stale data", this->stale_data_sensor_);
+  LOG_SENSOR("  ", "Auto-range adjustments", this->auto_range_adjustments_sensor_);
+#endif
+#ifdef USE_LTR_DIAGNOSTICS_TEXT
+  LOG_TEXT_SENSOR("  ", "State times", this->state_times_text_sensor_);
+  LOG_TEXT_SENSOR("  ", "Auto-range histogram", this->auto_range_histogram_text_sensor_);
+#endif
+#endif
+#ifdef USE_LTR_ALS_AGGREGATION
+  LOG_SENSOR("  ", "Ambient light mean", this->ambient_light_mean_sensor_);
+  LOG_SENSOR("  ", "Ambient light min", this->ambient_light_min_sensor_);
+  LOG_SENSOR("  ", "Ambient light max", this->ambient_light_max_sensor_);
+  LOG_SENSOR("  ", "Ambient light percentile", this->ambient_light_percentile_sensor_);
+  if (this->ambient_light_percentile_sensor_ != nullptr) {
+    ESP_LOGCONFIG(TAG, "    Percentile: %.0f%%", this->als_percentile_ * 100.0f);
+  }
+#endif
+#ifdef USE_LTR_PS
+  LOG_SENSOR("  ", "Proximity counts", this->proximity_counts_sensor_);
+#endif
+#ifdef USE_LTR_PS_STREAMING
+  LOG_SENSOR("  ", "Proximity min", this->proximity_min_sensor_);
+  LOG_SENSOR("  ", "Proximity max", this->proximity_max_sensor_);
+  LOG_SENSOR("  ", "Proximity mean", this->proximity_mean_sensor_);
+  LOG_SENSOR("  ", "Proximity median", this->proximity_median_sensor_);
+#endif
+  LOG_SENSOR("  ", "Suppressed publishes", this->suppressed_publishes_sensor_);
+  for (auto &deadband : this->deadbands_) {
+    ESP_LOGCONFIG(TAG, "  Deadband for '%s': %.3f or %.1f%%, max silence %u s", deadband.sensor->get_name().c_str(),
+                  deadband.absolute, deadband.relative * 100.0f, deadband.max_silence_ms / 1000);
+  }
 
   if (this->is_failed()) {
     ESP_LOGE(TAG, "Communication with I2C LTR-303/329 failed!");
@@ -108,139 +309,813 @@ void LTRAlsPsComponent::dump_config() {
 
 void LTRAlsPsComponent::update() {
   ESP_LOGV(TAG, "Updating");
-  if (this->is_ready() && this->state_ == State::IDLE) {
-    ESP_LOGV(TAG, "Initiating new data collection");
+#ifdef USE_LTR_TRACE
+  // slow sensors would otherwise sit on a partial batch for minutes, and lose it on reboot
+  this->flush_trace_();
+#endif
+  if (this->interrupt_pin_ != nullptr) {
+    // safety net - poll once per update interval in case an edge was missed
+    this->interrupt_pending_ = true;
+  }
+  // Once per update interval whatever the type and mode, report-on-change can be silent for hours
+  if (this->suppressed_publishes_sensor_ != nullptr && this->is_ready() &&
+      this->suppressed_publishes_sensor_->get_raw_state() != this->suppressed_publishes_) {
+    this->suppressed_publishes_sensor_->publish_state(this->suppressed_publishes_);
+  }
+#ifdef USE_LTR_PS
+  if (this->is_ps_() && this->is_ready()) {
+    this->publish_ps_data_();
+  }
+#endif
+#ifdef USE_LTR_ALS
+  if (!this->is_als_()) {
+    return;
+  }
+#ifdef USE_LTR_ALS_AGGREGATION
+  if (this->is_als_aggregation_() && this->is_ready()) {
+    // Sampling runs continuously, here we just flush the window. Restart only if the chain was broken.
+    this->publish_als_aggregate_();
+    if (this->state_ == State::IDLE) {
+      this->start_als_cycle_();
+    }
+    return;
+  }
+#endif
+  if (!this->is_ready() || this->state_ != State::IDLE) {
+    ESP_LOGV(TAG, "Component not ready yet");
+    return;
+  }
+
+  if (this->is_als_report_on_change_() && this->als_window_armed_) {
+    // New cycle is started from loop() once chip reports ALS reading outside of the window
+    if (this->interrupt_pin_ == nullptr && !this->is_ps_()) {
+      this->read_status_();  // nobody else polls status register in this configuration
+    }
+    return;
+  }
+
+  // Sensors on the same bus take turns, each one starts its cycle in its own slot.
+  // Slot is long enough to fit a measurement with one sensitivity adjustment.
+  uint32_t slot_ms = 2 * get_meas_time_ms(this->repeat_rate_) + get_itime_ms(this->integration_time_);
+  uint32_t frame_ms = std::min<uint32_t>(this->get_update_interval(), slot_ms * this->bus_scheduler_->size());
+  uint32_t delay_ms = this->bus_scheduler_->get_start_delay(this->bus_slot_, frame_ms);
+  if (delay_ms == 0) {
+    this->start_als_cycle_();
+    return;
+  }
+  ESP_LOGV(TAG, "Starting data collection in %u ms", delay_ms);
+  this->set_timeout("start", delay_ms, [this]() {
+    if (this->state_ == State::IDLE)
+      this->start_als_cycle_();
+  });
+#endif
+}
 
-    this->state_ = this->automatic_mode_enabled_ ? State::COLLECTING_DATA_AUTO : State::WAITING_FOR_DATA;
+#ifdef USE_LTR_ALS
+void LTRAlsPsComponent::start_als_cycle_() {
+  ESP_LOGV(TAG, "Initiating new data collection");
+#ifdef USE_LTR_DIAGNOSTICS
+  this->cycle_timing_.started_ms = millis();
+#endif
+  // Gain and integration time are kept from the previous sample - chip is still programmed with them,
+  // so the very first reading is valid. Auto-ranging corrects them if light has changed since.
+  this->als_readings_.ch0 = 0;
+  this->als_readings_.ch1 = 0;
+  this->als_readings_.lux = 0;
+  this->als_readings_.number_of_adjustments = 0;
+  this->state_ = this->is_als_standby_() ? State::WAKING_UP_ALS : State::WAITING_FOR_DATA;
+#ifdef USE_LTR_ADAPTIVE_SAMPLING
+  // Chip finishes the cycle it is in at the old repeat rate: no data for a while, and a sample still
+  // from that cycle can't be told from a new one. Wait as after an adjustment. Standby restarts the cycle.
+  uint32_t since_change_ms = millis() - this->adaptive_.rate_changed_ms;
+  if (this->state_ == State::WAITING_FOR_DATA && since_change_ms < this->adaptive_.rate_settle_ms) {
+    this->state_ = State::ADJUSTMENT_IN_PROGRESS;
+    this->set_state_after_(State::WAITING_FOR_DATA, this->adaptive_.rate_settle_ms - since_change_ms);
+  }
+  this->adaptive_.rate_settle_ms = 0;
+#endif
+}
 
-    this->als_readings_.ch0 = 0;
-    this->als_readings_.ch1 = 0;
-    this->als_readings_.gain = this->gain_;
-    this->als_readings_.integration_time = this->integration_time_;
-    this->als_readings_.lux = 0;
-    this->als_readings_.number_of_adjustments = 0;
+void LTRAlsPsComponent::restore_als_range_() {
+  this->range_pref_ =
+      global_preferences->make_preference<SettledRange>(fnv1_hash("ltr_als_ps_range") ^ this->preference_hash_);
+  SettledRange range;
+  if (!this->range_pref_.load(&range)) {
+    return;
+  }
+  // Stored range must still be valid with the current configuration
+  bool valid_gain = range.gain <= AlsGain::GAIN_8 || range.gain == AlsGain::GAIN_48 || range.gain == AlsGain::GAIN_96;
+  bool valid_time = range.integration_time <= IntegrationTime::INTEGRATION_TIME_350MS &&
+                    get_itime_ms(range.integration_time) <= get_meas_time_ms(this->repeat_rate_);
+  if (!valid_gain || !valid_time) {
+    return;
+  }
+  ESP_LOGD(TAG, "Restored settled range: gain = %.0fx, time = %d ms", get_gain_coeff(range.gain),
+           get_itime_ms(range.integration_time));
+  this->saved_range_ = range;
+  this->als_readings_.gain = range.gain;
+  this->als_readings_.integration_time = range.integration_time;
+}
 
-  } else {
-    ESP_LOGV(TAG, "Component not ready yet");
+void LTRAlsPsComponent::save_als_range_(const AlsReadings &data) {
+  if (data.gain == this->saved_range_.gain && data.integration_time == this->saved_range_.integration_time) {
+    return;  // spare the flash
   }
+  this->saved_range_ = {data.gain, data.integration_time};
+  this->range_pref_.save(&this->saved_range_);
 }
+#endif
 
 void LTRAlsPsComponent::loop() {
-  ErrorCode err = i2c::ERROR_OK;
-  static uint8_t tries{0};
+#ifdef USE_LTR_DIAGNOSTICS
+  uint8_t state = static_cast<uint8_t>(this->state_);
+  uint32_t started = micros();
+  this->run_state_machine_();
+  uint32_t elapsed = micros() - started;
+  this->cycle_timing_.loop_time_us += elapsed;
+  this->cycle_timing_.max_loop_time_us = std::max(this->cycle_timing_.max_loop_time_us, elapsed);
+  this->diagnostics_.max_loop_time_us = std::max(this->diagnostics_.max_loop_time_us, elapsed);
+  this->diagnostics_.state_time_us[state] += elapsed;
+#else
+  this->run_state_machine_();
+#endif
+}
 
+void LTRAlsPsComponent::run_state_machine_() {
+  // Every state does at most one bus transaction per loop() pass, the sample read two (status, then
+  // data). Queued writes get a pass of their own. Whenever chip needs time to settle we switch to
+  // a passive state and let scheduler bring us to the next one.
+  if (this->pending_mask_ != 0 && this->state_ >= State::IDLE) {
+    this->flush_pending_regs_();
+    return;
+  }
   switch (this->state_) {
     case State::DELAYED_SETUP:
-      err = this->write(nullptr, 0);
-      if (err != i2c::ERROR_OK) {
+      if (!this->configure_reset_()) {
         ESP_LOGV(TAG, "i2c connection failed");
         this->mark_failed();
+        return;
       }
-      this->configure_reset_();
-      if (this->is_als_()) {
-        this->configure_als_();
-        this->configure_integration_time_(this->integration_time_);
+      this->tries_ = 0;
+      this->state_ = State::SETUP_IN_PROGRESS;
+      this->set_state_after_(State::VERIFYING_RESET, 2);
+      break;
+
+    case State::VERIFYING_RESET: {
+      AlsControlRegister als_ctrl{0};
+      als_ctrl.raw = this->read_reg_(CommandRegisters::ALS_CONTR);
+      if (als_ctrl.sw_reset && this->tries_++ < MAX_TRIES) {
+        ESP_LOGV(TAG, "Waiting chip to reset");
+        this->state_ = State::SETUP_IN_PROGRESS;
+        this->set_state_after_(State::VERIFYING_RESET, 2);
+        break;
       }
-      if (this->is_ps_()) {
-        this->configure_ps_();
+      if (als_ctrl.sw_reset) {
+        ESP_LOGW(TAG, "Failed to finalize reset procedure");
+      }
+      this->tries_ = 0;
+      this->state_ = State::IDENTIFYING_PART;
+      break;
+    }
+
+    case State::IDENTIFYING_PART:
+      if (!this->check_part_number_()) {
+        return;
       }
+      this->state_ = this->next_setup_state_(State::VERIFYING_RESET);
+      break;
+
+#ifdef USE_LTR_ALS
+    case State::CONFIGURING_ALS:
+      this->configure_als_();
+      this->state_ = State::CONFIGURING_ALS_TIMING;
+      break;
+
+    case State::CONFIGURING_ALS_TIMING:
+      // configured or restored range
+      this->configure_integration_time_(this->als_readings_.integration_time);
+      this->state_ = State::SETUP_IN_PROGRESS;
+      this->set_state_after_(State::VERIFYING_ALS, 5);
+      break;
 
+    case State::VERIFYING_ALS:
+      if (!this->verify_als_configuration_(this->als_readings_.gain, this->als_readings_.integration_time,
+                                           !this->is_als_standby_())) {
+        if (this->tries_++ < MAX_TRIES) {
+          ESP_LOGV(TAG, "Waiting for device to become active...");
+          this->invalidate_shadow_();
+          this->state_ = State::CONFIGURING_ALS;
+          break;
+        }
+        ESP_LOGW(TAG, "Failed to activate device");
+      }
+      this->tries_ = 0;
+      this->state_ = this->next_setup_state_(State::VERIFYING_ALS);
+      break;
+#endif
+
+#ifdef USE_LTR_PS
+    case State::CONFIGURING_PS:
+      this->configure_ps_();
+      this->state_ = this->next_setup_state_(State::CONFIGURING_PS);
+      break;
+#endif
+
+    case State::CONFIGURING_INTERRUPTS:
+      this->configure_interrupt_persistence_();
+      this->state_ = State::ENABLING_INTERRUPTS;
+      break;
+
+    case State::ENABLING_INTERRUPTS:
+      this->configure_interrupts_();
       this->state_ = State::IDLE;
       break;
 
+    case State::SETUP_IN_PROGRESS:
+      // nothing to be done, just waiting for the timeout
+      break;
+
     case State::IDLE:
-      if (this->is_ps_()) {
-        check_and_trigger_ps_();
+      this->poll_ps_();
+#ifdef USE_LTR_ALS
+      if (this->als_change_detected_) {
+        ESP_LOGV(TAG, "Ambient light is out of the window");
+        this->start_als_cycle_();
       }
+#endif
       break;
 
-    case State::WAITING_FOR_DATA:
-      if (this->is_als_data_ready_(this->als_readings_) == DataAvail::DATA_OK) {
-        tries = 0;
-        ESP_LOGV(TAG, "Reading sensor data having gain = %.0fx, time = %d ms", get_gain_coeff(this->als_readings_.gain),
+#ifdef USE_LTR_ALS
+#ifdef USE_LTR_ALS_STANDBY
+    case State::WAKING_UP_ALS:
+      this->configure_gain_(this->als_readings_.gain);
+      if (this->als_awake_since_ms_ == 0) {
+        this->als_awake_since_ms_ = millis();
+        if (this->als_first_wake_ms_ == 0)
+          this->als_first_wake_ms_ = this->als_awake_since_ms_;
+      }
+      this->state_ = State::ADJUSTMENT_IN_PROGRESS;
+      this->set_state_after_(State::WAITING_FOR_DATA,
+                             ALS_WAKEUP_TIME_MS + get_itime_ms(this->als_readings_.integration_time));
+      break;
+#endif
+
+    case State::WAITING_FOR_DATA: {
+      if (!this->bus_scheduler_->try_poll(this->bus_slot_)) {
+        break;  // not our turn, doesn't count as a try
+      }
+      DataAvail avail = this->read_sensor_data_(this->als_readings_);
+#ifdef USE_LTR_DIAGNOSTICS
+      if (avail == DataAvail::NO_DATA) {
+        this->diagnostics_.stale_data++;
+      } else if (avail == DataAvail::BAD_DATA || avail == DataAvail::RANGE_MISMATCH) {
+        this->diagnostics_.bad_data++;
+      }
+#endif
+      if (avail == DataAvail::DATA_OK) {
+        this->tries_ = 0;
+        ESP_LOGV(TAG, "Got sensor data having gain = %.0fx, time = %d ms", get_gain_coeff(this->als_readings_.gain),
                  get_itime_ms(this->als_readings_.integration_time));
-        this->read_sensor_data_(this->als_readings_);
         this->state_ = State::DATA_COLLECTED;
         this->apply_lux_calculation_(this->als_readings_);
-      } else if (tries >= MAX_TRIES) {
-        ESP_LOGW(TAG, "Can't get data after several tries.");
-        tries = 0;
-        this->status_set_warning();
-        this->state_ = State::IDLE;
-        return;
+      } else if (avail == DataAvail::RANGE_MISMATCH && this->als_readings_.number_of_adjustments++ < MAX_TRIES) {
+        // Chip doesn't have the range we think it has - written values didn't stick or chip was reset.
+        // This is the only verification of adjustments, saves reading back the registers every time.
+        this->invalidate_shadow_();
+        this->tries_ = 0;
+        this->state_ = State::APPLYING_INTEGRATION_TIME;
       } else {
-        tries++;
+        // Chip delivers a sample every repeat period, at a phase we don't know. Instead of polling every loop()
+        // check a few times per period, and give up only when no sample came for two periods plus integration time.
+        uint32_t now = millis();
+        if (this->tries_++ == 0) {
+          this->data_wait_started_ms_ = now;
+        }
+        uint32_t period_ms = get_meas_time_ms(this->repeat_rate_);
+        uint32_t budget_ms = 2 * period_ms + get_itime_ms(this->als_readings_.integration_time);
+        uint32_t waited_ms = now - this->data_wait_started_ms_;
+        if (waited_ms >= budget_ms) {
+          ESP_LOGW(TAG, "Can't get data within %u ms.", budget_ms);
+#ifdef USE_LTR_DIAGNOSTICS
+          this->diagnostics_.data_timeouts++;
+#endif
+#ifdef USE_LTR_ALS_STANDBY
+          if (this->is_als_standby_()) {
+            // no sample this time, still don't leave the chip measuring till the next update
+            this->als_enter_standby_();
+          }
+#endif
+          // cycle is abandoned, a pending change would restart it straight away
+          this->als_change_detected_ = false;
+          this->tries_ = 0;
+          this->status_set_warning();
+          this->state_ = State::IDLE;
+          break;
+        }
+        uint32_t poll_ms = std::max<uint32_t>(period_ms / 4, MIN_POLL_INTERVAL_MS);
+        this->state_ = State::WAITING_FOR_NEXT_SAMPLE;
+        this->set_state_after_(State::WAITING_FOR_DATA, std::min(poll_ms, budget_ms - waited_ms));
       }
       break;
+    }
 
-    case State::COLLECTING_DATA_AUTO:
     case State::DATA_COLLECTED:
-      // first measurement in auto mode (COLLECTING_DATA_AUTO state) require device reconfiguration
-      if (this->state_ == State::COLLECTING_DATA_AUTO || this->are_adjustments_required_(this->als_readings_)) {
-        this->state_ = State::ADJUSTMENT_IN_PROGRESS;
+      if (this->are_adjustments_required_(this->als_readings_)) {
         ESP_LOGD(TAG, "Reconfiguring sensitivity: gain = %.0fx, time = %d ms", get_gain_coeff(this->als_readings_.gain),
                  get_itime_ms(this->als_readings_.integration_time));
-        this->configure_integration_time_(this->als_readings_.integration_time);
-        this->configure_gain_(this->als_readings_.gain);
-        // if sensitivity adjustment needed - need to wait for first data samples after setting new parameters
-        this->set_timeout(2 * get_meas_time_ms(this->repeat_rate_),
-                          [this]() { this->state_ = State::WAITING_FOR_DATA; });
-      } else {
-        this->state_ = State::READY_TO_PUBLISH;
+        this->tries_ = 0;
+        this->state_ = State::APPLYING_INTEGRATION_TIME;
+        break;
+      }
+#ifdef USE_LTR_DIAGNOSTICS
+      this->diagnostics_.adjustments[std::min<uint8_t>(this->als_readings_.number_of_adjustments,
+                                                       ADJUSTMENT_BUCKETS - 1)]++;
+      if (this->cycle_timing_.settle_time_ms == 0) {
+        this->cycle_timing_.settle_time_ms = millis() - this->cycle_timing_.started_ms;
+      }
+#endif
+      if (this->automatic_mode_enabled_) {
+        this->save_als_range_(this->als_readings_);
+      }
+#ifdef USE_LTR_ALS_AGGREGATION
+      if (this->is_als_aggregation_()) {
+        this->add_als_sample_(this->als_readings_);
+        this->state_ = State::WAITING_FOR_NEXT_SAMPLE;
+        this->set_state_after_(State::WAITING_FOR_DATA, get_meas_time_ms(this->repeat_rate_));
+        break;
+      }
+#endif
+      this->state_ = State::READY_TO_PUBLISH;
+      break;
+
+    case State::APPLYING_INTEGRATION_TIME:
+      if (!this->configure_integration_time_(this->als_readings_.integration_time) && this->tries_++ == 0) {
+        ESP_LOGW(TAG, "Failed to set integration time. We will try one more time.");
+        break;
+      }
+      this->tries_ = 0;
+      this->state_ = State::APPLYING_GAIN;
+      break;
+
+    case State::APPLYING_GAIN:
+      if (!this->configure_gain_(this->als_readings_.gain) && this->tries_++ == 0) {
+        ESP_LOGW(TAG, "Failed to set gain. We will try one more time.");
+        break;
       }
+      // Gain chip actually uses is verified from the status register along with the data.
+      // Need to wait for first data samples after setting new parameters.
+      this->tries_ = 0;
+      this->state_ = State::ADJUSTMENT_IN_PROGRESS;
+      this->set_state_after_(State::WAITING_FOR_DATA, 2 * get_meas_time_ms(this->repeat_rate_));
       break;
 
     case State::ADJUSTMENT_IN_PROGRESS:
-      // nothing to be done, just waiting for the timeout
+      // ALS is waiting for the timeout, proximity goes on on its own
+      this->poll_ps_();
+      break;
+
+    case State::WAITING_FOR_NEXT_SAMPLE:
+      if (this->poll_ps_().als_new_data) {
+        // status read for proximity shows ALS sample is ready, no need to wait for the timer
+        this->cancel_timeout("state");
+        this->state_ = State::WAITING_FOR_DATA;
+      }
       break;
 
     case State::READY_TO_PUBLISH:
+#ifdef USE_LTR_ALS_STANDBY
+      if (this->is_als_standby_()) {
+        // we have got the sample, don't keep the chip busy while publishing
+        this->als_enter_standby_();
+      }
+#endif
       this->publish_data_part_1_(this->als_readings_);
       this->state_ = State::KEEP_PUBLISHING;
       break;
 
     case State::KEEP_PUBLISHING:
       this->publish_data_part_2_(this->als_readings_);
+      if (this->is_als_report_on_change_()) {
+        this->configure_als_window_(this->als_readings_);
+      }
+#ifdef USE_LTR_ADAPTIVE_SAMPLING
+      if (this->is_adaptive_sampling_() && this->adapt_sampling_rate_(this->als_readings_.lux)) {
+        // MEAS_RATE holds both repeat rate and integration time
+        this->configure_integration_time_(this->als_readings_.integration_time);
+      }
+#endif
+      this->log_sample_stats_();
       this->status_clear_warning();
       this->state_ = State::IDLE;
       break;
+#endif
 
     default:
       break;
   }
 }
 
-void LTRAlsPsComponent::check_and_trigger_ps_() {
-  static uint32_t last_high_trigger_time{0};
-  static uint32_t last_low_trigger_time{0};
-  uint16_t ps_data = this->read_ps_data_();
+#ifdef USE_LTR_TRACE
+void LTRAlsPsComponent::flush_trace_() {
+  if (this->trace_count_ == 0) {
+    return;
+  }
+  ESP_LOGI(TAG, "trace: %s",
+           format_hex(reinterpret_cast<const uint8_t *>(this->trace_batch_), this->trace_count_ * sizeof(TraceRecord))
+               .c_str());
+  this->trace_count_ = 0;
+}
+
+LTRAlsPsComponent::TraceRecord &LTRAlsPsComponent::next_trace_record_() {
+  if (this->trace_count_ == TRACE_BATCH) {
+    this->flush_trace_();
+  }
+  auto &record = this->trace_batch_[this->trace_count_++];
+  record = TraceRecord{};
+  record.timestamp_ms = millis();
+  return record;
+}
+#endif
+
+#ifdef USE_LTR_ALS_STANDBY
+void LTRAlsPsComponent::als_enter_standby_() {
+  this->configure_gain_(this->als_readings_.gain, false);
+  if (this->als_awake_since_ms_ == 0) {
+    return;
+  }
+  uint32_t now = millis();
+  this->als_active_time_ms_ += now - this->als_awake_since_ms_;
+  this->als_awake_since_ms_ = 0;
+
+  uint32_t elapsed_ms = now - this->als_first_wake_ms_;
+  if (elapsed_ms == 0) {
+    return;
+  }
+  float active_s_per_hour = 3600.0f * this->als_active_time_ms_ / elapsed_ms;
+  ESP_LOGD(TAG, "ALS active for %u ms in %u s, estimated %.1f s per hour", this->als_active_time_ms_,
+           elapsed_ms / 1000, active_s_per_hour);
+  if (this->als_active_time_sensor_ != nullptr) {
+    this->publish_state_(this->als_active_time_sensor_, active_s_per_hour);
+  }
+}
+#endif
+
+#ifdef USE_LTR_ADAPTIVE_SAMPLING
+bool LTRAlsPsComponent::adapt_sampling_rate_(float lux) {
+  auto &adaptive = this->adaptive_;
+  float last_lux = adaptive.last_lux;
+  adaptive.last_lux = lux;
+  if (std::isnan(last_lux)) {
+    return false;
+  }
+
+  // 1 lx floor keeps noise in the dark from looking like a big relative change
+  float change = std::fabs(lux - last_lux) / std::max(last_lux, 1.0f);
+  uint32_t interval = this->get_update_interval();
+  uint32_t new_interval = interval;
+  if (change > adaptive.change_threshold) {
+    new_interval = adaptive.min_interval_ms;
+  } else if (change < adaptive.change_threshold / 2) {
+    new_interval = std::min(interval * 2, adaptive.max_interval_ms);
+  }
+
+  if (new_interval != interval) {
+    ESP_LOGD(TAG, "Light changed by %.1f%%, update interval %u -> %u ms", change * 100.0f, interval, new_interval);
+    this->set_update_interval(new_interval);
+    this->stop_poller();
+    this->start_poller();
+  }
+
+  // Chip measures continuously, slow it down as long as there are several fresh samples per interval
+  auto rate = adaptive.base_repeat_rate;
+  while (rate < MeasurementRepeatRate::REPEAT_RATE_2000MS &&
+         4 * get_meas_time_ms(static_cast<MeasurementRepeatRate>(rate + 1)) <= new_interval) {
+    rate = static_cast<MeasurementRepeatRate>(rate + 1);
+  }
+  if (rate == this->repeat_rate_) {
+    return false;
+  }
+  uint32_t old_period_ms = get_meas_time_ms(this->repeat_rate_);
+  ESP_LOGD(TAG, "Measurement repeat rate %u -> %u ms", old_period_ms, get_meas_time_ms(rate));
+  this->repeat_rate_ = rate;
+
+  // Auto-ranging may have picked a longer integration time while the rate was slowed down,
+  // it has to fit into the faster repeat rate again. Next sample re-ranges if needed.
+  auto &time = this->als_readings_.integration_time;
+  uint16_t max_time_ms = get_meas_time_ms(rate);
+  if (get_itime_ms(time) > max_time_ms) {
+    auto fitting = INTEGRATION_TIME_50MS;
+    for (uint8_t candidate = 0; candidate < TIMES_COUNT; candidate++) {
+      uint16_t candidate_ms = get_itime_ms(static_cast<IntegrationTime>(candidate));
+      if (candidate_ms <= max_time_ms && candidate_ms > get_itime_ms(fitting)) {
+        fitting = static_cast<IntegrationTime>(candidate);
+      }
+    }
+    ESP_LOGD(TAG, "Integration time %u -> %u ms to fit the repeat rate", get_itime_ms(time), get_itime_ms(fitting));
+    time = fitting;
+  }
+  // new settings are latched when the cycle in progress ends, at most an old period from now
+  adaptive.rate_changed_ms = millis();
+  adaptive.rate_settle_ms = old_period_ms + get_itime_ms(time);
+  return true;
+}
+#endif
+
+void LTRAlsPsComponent::set_state_after_(State state, uint32_t delay_ms) {
+  this->set_timeout("state", delay_ms, [this, state]() { this->state_ = state; });
+}
+
+LTRAlsPsComponent::State LTRAlsPsComponent::next_setup_state_(State state) const {
+  // Setup steps go in this order, skipping ones not relevant to the configuration
+  switch (state) {
+    case State::VERIFYING_RESET:
+      if (this->is_als_())
+        return State::CONFIGURING_ALS;
+      // fall through
+    case State::VERIFYING_ALS:
+      if (this->is_ps_())
+        return State::CONFIGURING_PS;
+      // fall through
+    case State::CONFIGURING_PS:
+      if (this->is_ps_interrupt_mode_() || this->is_als_report_on_change_())
+        return State::CONFIGURING_INTERRUPTS;
+      // fall through
+    default:
+      return State::IDLE;
+  }
+}
+
+void LTRAlsPsComponent::log_sample_stats_() {
+  uint32_t now = millis();
+  if (!this->first_sample_published_) {
+    this->first_sample_published_ = true;
+    ESP_LOGD(TAG, "First sample published %u ms after setup", now - this->setup_time_ms_);
+  }
+#ifdef USE_LTR_DIAGNOSTICS
+#ifdef USE_LTR_ALS
+  ESP_LOGD(TAG, "Sample settled in %u ms after %d adjustments", this->cycle_timing_.settle_time_ms,
+           this->als_readings_.number_of_adjustments);
+#endif
+  ESP_LOGD(TAG, "Bus usage for this sample: %u transactions, %u bytes", this->bus_usage_.transactions,
+           this->bus_usage_.bytes);
+  ESP_LOGD(TAG, "Time spent in loop(): %u us total, %u us max", this->cycle_timing_.loop_time_us,
+           this->cycle_timing_.max_loop_time_us);
+  this->bus_usage_ = {};
+  this->cycle_timing_ = {};
+#endif
+  if (!this->deadbands_.empty()) {
+    ESP_LOGD(TAG, "Publishes suppressed by deadbands so far: %u", this->suppressed_publishes_);
+  }
+}
+
+#ifdef USE_LTR_DIAGNOSTICS
+// No default branch: a state added to the enum without a name here is a -Wswitch warning
+const char *LTRAlsPsComponent::state_name_(State state) {
+  switch (state) {
+    case State::NOT_INITIALIZED:
+      return "not initialized";
+    case State::DELAYED_SETUP:
+      return "delayed setup";
+    case State::VERIFYING_RESET:
+      return "verifying reset";
+    case State::IDENTIFYING_PART:
+      return "identifying part";
+    case State::CONFIGURING_ALS:
+      return "configuring ALS";
+    case State::CONFIGURING_ALS_TIMING:
+      return "configuring ALS timing";
+    case State::VERIFYING_ALS:
+      return "verifying ALS";
+    case State::CONFIGURING_PS:
+      return "configuring PS";
+    case State::CONFIGURING_INTERRUPTS:
+      return "configuring interrupts";
+    case State::ENABLING_INTERRUPTS:
+      return "enabling interrupts";
+    case State::SETUP_IN_PROGRESS:
+      return "setup in progress";
+    case State::IDLE:
+      return "idle";
+    case State::WAKING_UP_ALS:
+      return "waking up ALS";
+    case State::WAITING_FOR_DATA:
+      return "waiting for data";
+    case State::DATA_COLLECTED:
+      return "data collected";
+    case State::APPLYING_INTEGRATION_TIME:
+      return "applying integration time";
+    case State::APPLYING_GAIN:
+      return "applying gain";
+    case State::ADJUSTMENT_IN_PROGRESS:
+      return "adjustment in progress";
+    case State::WAITING_FOR_NEXT_SAMPLE:
+      return "waiting for next sample";
+    case State::READY_TO_PUBLISH:
+      return "ready to publish";
+    case State::KEEP_PUBLISHING:
+      return "keep publishing";
+  }
+  return "unknown";
+}
+
+void LTRAlsPsComponent::publish_diagnostics_() {
+  auto &diag = this->diagnostics_;
+  ESP_LOGD(TAG, "Diagnostics: %u I2C transactions, %u errors, max loop() %u us in the last minute",
+           diag.i2c_transactions, diag.i2c_errors, diag.max_loop_time_us);
+  for (uint8_t i = 0; i < STATES_COUNT; i++) {
+    if (diag.state_time_us[i] > 0) {
+      ESP_LOGV(TAG, "  Time in state '%s': %u us", state_name_(static_cast<State>(i)), diag.state_time_us[i]);
+    }
+  }
+
+  if (this->i2c_transactions_sensor_ != nullptr) {
+    this->publish_state_(this->i2c_transactions_sensor_, diag.i2c_transactions);
+  }
+  if (this->i2c_errors_sensor_ != nullptr) {
+    this->publish_state_(this->i2c_errors_sensor_, diag.i2c_errors);
+  }
+  if (this->max_loop_time_sensor_ != nullptr) {
+    this->publish_state_(this->max_loop_time_sensor_, diag.max_loop_time_us);
+  }
+#ifdef USE_LTR_DIAGNOSTICS_TEXT
+  if (this->state_times_text_sensor_ != nullptr) {
+    // busiest state first, states that took no time are left out; stops short of the 255 char state limit
+    uint8_t order[STATES_COUNT];
+    for (uint8_t i = 0; i < STATES_COUNT; i++)
+      order[i] = i;
+    std::stable_sort(std::begin(order), std::end(order),
+                     [&diag](uint8_t a, uint8_t b) { return diag.state_time_us[a] > diag.state_time_us[b]; });
+    char buf[256];
+    size_t len = 0;
+    buf[0] = '\0';
+    for (uint8_t i : order) {
+      if (diag.state_time_us[i] == 0)
+        break;
+      int n = snprintf(buf + len, sizeof(buf) - len, "%s%s %uus", len > 0 ? ", " : "",
+                       state_name_(static_cast<State>(i)), diag.state_time_us[i]);
+      if (n < 0 || len + n >= sizeof(buf)) {
+        buf[len] = '\0';
+        break;
+      }
+      len += n;
+    }
+    this->state_times_text_sensor_->publish_state(buf);
+  }
+#endif
+
+#ifdef USE_LTR_ALS
+  uint32_t samples = 0;
+  uint32_t adjustments = 0;
+  for (uint8_t i = 0; i < ADJUSTMENT_BUCKETS; i++) {
+    samples += diag.adjustments[i];
+    adjustments += diag.adjustments[i] * i;
+  }
+  ESP_LOGD(TAG, "  Data timeouts: %u, bad data: %u, stale polls: %u", diag.data_timeouts, diag.bad_data,
+           diag.stale_data);
+  ESP_LOGD(TAG, "  Adjustments per sample histogram: 0:%u 1:%u 2:%u 3:%u 4:%u 5+:%u", diag.adjustments[0],
+           diag.adjustments[1], diag.adjustments[2], diag.adjustments[3], diag.adjustments[4], diag.adjustments[5]);
+
+  if (this->data_timeouts_sensor_ != nullptr) {
+    this->publish_state_(this->data_timeouts_sensor_, diag.data_timeouts);
+  }
+  if (this->bad_data_sensor_ != nullptr) {
+    this->publish_state_(this->bad_data_sensor_, diag.bad_data);
+  }
+  if (this->stale_data_sensor_ != nullptr) {
+    this->publish_state_(this->stale_data_sensor_, diag.stale_data);
+  }
+  if (this->auto_range_adjustments_sensor_ != nullptr && samples > 0) {
+    this->publish_state_(this->auto_range_adjustments_sensor_, (float) adjustments / samples);
+  }
+#ifdef USE_LTR_DIAGNOSTICS_TEXT
+  if (this->auto_range_histogram_text_sensor_ != nullptr) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "0:%u 1:%u 2:%u 3:%u 4:%u 5+:%u", diag.adjustments[0], diag.adjustments[1],
+             diag.adjustments[2], diag.adjustments[3], diag.adjustments[4], diag.adjustments[5]);
+    this->auto_range_histogram_text_sensor_->publish_state(buf);
+  }
+#endif
+#endif
+
+  diag.i2c_transactions = 0;
+  diag.i2c_errors = 0;
+  diag.max_loop_time_us = 0;
+  std::fill(std::begin(diag.state_time_us), std::end(diag.state_time_us), 0);
+}
+#endif
+
+AlsPsStatusRegister LTRAlsPsComponent::read_status_() {
+  // ALS_PS_STATUS, PS_DATA_0 and PS_DATA_1 are adjacent - single transaction
+  uint8_t buf[3]{0};
+  AlsPsStatusRegister als_status{0};
+  if (!this->read_regs_(CommandRegisters::ALS_PS_STATUS, buf, this->is_ps_() ? 3 : 1)) {
+    return als_status;
+  }
+
+  als_status.raw = buf[0];
+#ifdef USE_LTR_PS
+  if (this->is_ps_() && als_status.ps_new_data && !als_status.data_invalid) {
+    this->process_ps_data_(decode_ps_data(buf[1], buf[2]));
+  }
+#endif
+#ifdef USE_LTR_ALS
+  if (als_status.als_interrupt && this->als_window_armed_) {
+    this->als_change_detected_ = true;
+  }
+#endif
+  return als_status;
+}
+
+AlsPsStatusRegister LTRAlsPsComponent::poll_ps_() {
+  // Proximity doesn't depend on ALS cycle, it is polled from every state which is just waiting
+  AlsPsStatusRegister als_status{0};
+  // calibration and presence need a steady flow of samples, interrupts would deliver just a few
+  if (this->interrupt_pin_ != nullptr && !this->is_ps_streaming_() && !this->is_ps_calibrating_() &&
+      !this->is_ps_presence_()) {
+    if (this->interrupt_pending_) {
+      this->interrupt_pending_ = false;
+      als_status = this->read_status_();  // reading status register also clears interrupt on the chip
+    }
+  } else if (this->is_ps_() && this->bus_scheduler_->try_poll(this->bus_slot_)) {
+    als_status = this->read_status_();
+  }
+  return als_status;
+}
+
+#ifdef USE_LTR_PS
+void LTRAlsPsComponent::process_ps_data_(uint16_t ps_data) {
+#ifdef USE_LTR_TRACE
+  if (this->trace_) {
+    auto &record = this->next_trace_record_();
+    record.ps = ps_data;
+    record.ps_valid = true;
+  }
+#endif
+#ifdef USE_LTR_PS_LED_CONTROL
+  if (this->ps_led_control_.enabled && !this->control_ps_led_(ps_data)) {
+    return;
+  }
+#endif
+#ifdef USE_LTR_PS_CALIBRATION
+  if (this->ps_calibration_.enabled && !this->calibrate_ps_(ps_data)) {
+    return;  // uncalibrated sample, keep it away from automations
+  }
+#endif
   uint32_t now = millis();
+  this->ps_updated_ = true;
+#ifdef USE_LTR_PS_PRESENCE
+  if (this->is_ps_presence_()) {
+    this->update_presence_(ps_data, now);
+  }
+#endif
+
+#ifdef USE_LTR_PS_STREAMING
+  this->ps_histogram_.push(ps_data);
+  this->ps_statistics_.min = std::min(this->ps_statistics_.min, ps_data);
+  this->ps_statistics_.max = std::max(this->ps_statistics_.max, ps_data);
+  this->ps_statistics_.sum += ps_data;
+  this->ps_statistics_.count++;
+  this->on_ps_sample_callback_.call(ps_data);
+#endif
 
   if (ps_data != this->ps_readings_) {
     this->ps_readings_ = ps_data;
     // Higher values - object is closer to sensor
-    if (ps_data > this->ps_threshold_high_ && now - last_high_trigger_time >= this->ps_cooldown_time_s_ * 1000) {
-      last_high_trigger_time = now;
+    if (ps_data > this->ps_threshold_high_ &&
+        now - this->ps_last_high_trigger_time_ >= this->ps_cooldown_time_s_ * 1000) {
+      this->ps_last_high_trigger_time_ = now;
       ESP_LOGV(TAG, "Proximity high threshold triggered. Value = %d, Trigger level = %d", ps_data,
                this->ps_threshold_high_);
       this->on_ps_high_trigger_callback_.call();
-    } else if (ps_data < this->ps_threshold_low_ && now - last_low_trigger_time >= this->ps_cooldown_time_s_ * 1000) {
-      last_low_trigger_time = now;
+    } else if (ps_data < this->ps_threshold_low_ &&
+               now - this->ps_last_low_trigger_time_ >= this->ps_cooldown_time_s_ * 1000) {
+      this->ps_last_low_trigger_time_ = now;
       ESP_LOGV(TAG, "Proximity low threshold triggered. Value = %d, Trigger level = %d", ps_data,
                this->ps_threshold_low_);
       this->on_ps_low_trigger_callback_.call();
     }
   }
-}
 
-bool LTRAlsPsComponent::check_part_number_() {
-  uint8_t manuf_id = this->reg((uint8_t) CommandRegisters::MANUFAC_ID).get();
-  if (manuf_id != 0x05) {  // 0x05 is Lite-On Semiconductor Corp. ID
-    ESP_LOGW(TAG, "Unknown manufacturer ID: 0x%02X", manuf_id);
-    this->mark_failed();
-    return false;
+  if (this->is_ps_interrupt_mode_()) {
+    // Move interrupt window so that chip wakes us up only when the next trigger is possible:
+    // object is close - wait for it to go away, object is away - wait for it to come close.
+    uint16_t high = std::min<uint16_t>(this->ps_threshold_high_, 0x7ff);
+    uint16_t low = this->ps_threshold_low_;
+    if (this->ps_readings_ > high) {
+      high = 0x7ff;
+    } else if (this->ps_readings_ < low) {
+      low = 0;
+    }
+    if (low != this->ps_window_low_ || high != this->ps_window_high_) {
+      this->configure_ps_thresholds_(low, high);
+    }
   }
+}
+#endif
+
+void IRAM_ATTR LTRAlsPsComponent::gpio_intr(LTRAlsPsComponent *arg) { arg->interrupt_pending_ = true; }
 
+bool LTRAlsPsComponent::check_part_number_() {
   // Things getting not really funny here, we can't identify device type by part number ID
   // ======================== ========= ===== =================
   // Device                    Part ID   Rev   Capabilities
@@ -251,129 +1126,330 @@ bool LTRAlsPsComponent::check_part_number_() {
   //
   // There are other devices which might potentially work with default settings,
   // but registers layout is different and we can't use them properly. For ex. ltr-558
+  struct PartCapabilities {
+    uint8_t part_number_id;
+    const char *name;
+    bool als;
+    bool ps;
+  };
+  static const PartCapabilities PARTS[] = {
+      {0x0a, "LTR-303/329", true, false},
+      {0x09, "LTR-553/556/559/659", true, true},  // LTR-659 has no ALS, but can't be told apart
+  };
+
+  // PART_ID and MANUFAC_ID are adjacent - single transaction
+  uint8_t buf[2]{0};
+  if (!this->read_regs_(CommandRegisters::PART_ID, buf, sizeof(buf))) {
+    ESP_LOGW(TAG, "Failed to read part ID, going on with configured type");
+    return true;
+  }
+  if (buf[1] != 0x05) {  // 0x05 is Lite-On Semiconductor Corp. ID
+    ESP_LOGW(TAG, "Unknown manufacturer ID: 0x%02X", buf[1]);
+    this->mark_failed();
+    return false;
+  }
 
   PartIdRegister part_id{0};
-  part_id.raw = this->reg((uint8_t) CommandRegisters::PART_ID).get();
-  if (part_id.part_number_id != 0x0a && part_id.part_number_id != 0x09) {
+  part_id.raw = buf[0];
+  const PartCapabilities *part = nullptr;
+  for (const auto &candidate : PARTS) {
+    if (candidate.part_number_id == part_id.part_number_id)
+      part = &candidate;
+  }
+  if (part == nullptr) {
     ESP_LOGW(TAG, "Unknown part number ID: 0x%02X. It might not work properly.", part_id.part_number_id);
     this->status_set_warning();
     return true;
   }
+  this->part_name_ = part->name;
+  ESP_LOGD(TAG, "Detected %s, revision %u", part->name, part_id.revision_id);
+
+  // Drop what chip doesn't have - no point in register traffic it ignores
+  bool als = this->is_als_() && part->als;
+  bool ps = this->is_ps_() && part->ps;
+  if (this->is_ps_() && !ps) {
+    ESP_LOGW(TAG, "%s has no proximity sensor, proximity part of the config is ignored", part->name);
+  }
+  if (this->is_als_() && !als) {
+    ESP_LOGW(TAG, "%s has no ambient light sensor, ALS part of the config is ignored", part->name);
+  }
+  if (!als && !ps) {
+    ESP_LOGE(TAG, "Nothing configured is supported by %s", part->name);
+    this->mark_failed();
+    return false;
+  }
+  if (als && ps) {
+    this->ltr_type_ = LtrType::LTR_TYPE_ALS_AND_PS;
+  } else {
+    this->ltr_type_ = als ? LtrType::LTR_TYPE_ALS_ONLY : LtrType::LTR_TYPE_PS_ONLY;
+  }
   return true;
 }
 
-void LTRAlsPsComponent::configure_reset_() {
-  ESP_LOGV(TAG, "Resetting");
+uint8_t LTRAlsPsComponent::read_reg_(CommandRegisters reg) {
+  uint8_t value = 0;
+  this->read_regs_(reg, &value, 1);
+  return value;
+}
 
-  AlsControlRegister als_ctrl{0};
-  als_ctrl.sw_reset = true;
-  this->reg((uint8_t) CommandRegisters::ALS_CONTR) = als_ctrl.raw;
-  delay(2);
+bool LTRAlsPsComponent::read_regs_(CommandRegisters start, uint8_t *data, uint8_t len) {
+  // Device auto-increments register address, so adjacent registers can be read in one transaction
+  bool ok = this->read_register((uint8_t) start, data, len) == i2c::ERROR_OK;
+  this->account_bus_transaction_(1 + len, ok);
+  if (ok) {
+    this->update_shadow_(start, data, len, true);
+  }
+  return ok;
+}
+
+bool LTRAlsPsComponent::write_reg_(CommandRegisters reg, uint8_t value) {
+  return this->write_regs_(reg, &value, 1);
+}
 
-  uint8_t tries = MAX_TRIES;
-  do {
-    ESP_LOGV(TAG, "Waiting chip to reset");
-    delay(2);
-    als_ctrl.raw = this->reg((uint8_t) CommandRegisters::ALS_CONTR).get();
-  } while (als_ctrl.sw_reset && tries--);  // while sw reset bit is on - keep waiting
+bool LTRAlsPsComponent::write_regs_(CommandRegisters start, const uint8_t *data, uint8_t len) {
+  uint8_t first = static_cast<uint8_t>(start) - SHADOW_BASE;
+  bool unchanged = first + len <= SHADOW_SIZE;
+  for (uint8_t i = 0; unchanged && i < len; i++) {
+    unchanged = (this->shadow_valid_ & (1u << (first + i))) && this->shadow_[first + i] == data[i];
+  }
+  if (unchanged) {
+    ESP_LOGVV(TAG, "Register 0x%02X already has the value, write skipped", (uint8_t) start);
+    return true;
+  }
 
-  if (als_ctrl.sw_reset) {
-    ESP_LOGW(TAG, "Failed to finalize reset procedure");
+  bool ok = this->write_register((uint8_t) start, data, len) == i2c::ERROR_OK;
+  this->account_bus_transaction_(1 + len, ok);
+  this->update_shadow_(start, data, len, ok);
+  return ok;
+}
+
+void LTRAlsPsComponent::queue_regs_(CommandRegisters start, const uint8_t *data, uint8_t len) {
+  uint8_t first = static_cast<uint8_t>(start) - SHADOW_BASE;
+  for (uint8_t i = first; i < first + len && i < SHADOW_SIZE; i++) {
+    uint32_t bit = 1u << i;
+    if ((this->shadow_valid_ & bit) && this->shadow_[i] == data[i - first]) {
+      this->pending_mask_ &= ~bit;  // back to what chip has, nothing to write
+      continue;
+    }
+    this->pending_[i] = data[i - first];
+    this->pending_mask_ |= bit;
   }
 }
 
+void LTRAlsPsComponent::flush_pending_regs_() {
+  uint8_t first = __builtin_ctz(this->pending_mask_);
+  uint8_t len = 1;
+  while (first + len < SHADOW_SIZE && (this->pending_mask_ & (1u << (first + len))))
+    len++;
+
+  auto start = static_cast<CommandRegisters>(SHADOW_BASE + first);
+  if (this->write_regs_(start, &this->pending_[first], len)) {
+    this->pending_failures_ = 0;
+#ifdef USE_LTR_PS
+    this->sync_ps_window_();
+#endif
+  } else if (++this->pending_failures_ < MAX_TRIES) {
+    return;  // keep it queued, retry on the next pass
+  } else {
+    ESP_LOGW(TAG, "Failed to write register 0x%02X, dropped", (uint8_t) start);
+    this->pending_failures_ = 0;
+  }
+  this->pending_mask_ &= ~(((1u << len) - 1) << first);
+}
+
+void LTRAlsPsComponent::update_shadow_(CommandRegisters start, const uint8_t *data, uint8_t len, bool valid) {
+  uint8_t first = static_cast<uint8_t>(start) - SHADOW_BASE;
+  for (uint8_t i = first; i < first + len && i < SHADOW_SIZE; i++) {
+    uint32_t bit = 1u << i;
+    if (!(SHADOW_WRITABLE & bit))
+      continue;
+    this->shadow_[i] = data[i - first];
+    if (valid) {
+      this->shadow_valid_ |= bit;
+    } else {
+      this->shadow_valid_ &= ~bit;  // failed write, chip content is unknown
+    }
+  }
+}
+
+bool LTRAlsPsComponent::configure_reset_() {
+  ESP_LOGV(TAG, "Resetting");
+
+  AlsControlRegister als_ctrl{0};
+  als_ctrl.sw_reset = true;
+  bool ok = this->write_reg_(CommandRegisters::ALS_CONTR, als_ctrl.raw);
+  this->invalidate_shadow_();
+  return ok;
+}
+
+#ifdef USE_LTR_ALS
 void LTRAlsPsComponent::configure_als_() {
   AlsControlRegister als_ctrl{0};
 
   als_ctrl.sw_reset = false;
-  als_ctrl.active_mode = true;
-  als_ctrl.gain = this->gain_;
-
-  ESP_LOGV(TAG, "Setting active mode and gain reg 0x%02X", als_ctrl.raw);
-  this->reg((uint8_t) CommandRegisters::ALS_CONTR) = als_ctrl.raw;
-  delay(5);
+  als_ctrl.active_mode = !this->is_als_standby_();
+  als_ctrl.gain = this->als_readings_.gain;
 
-  uint8_t tries = MAX_TRIES;
-  do {
-    ESP_LOGV(TAG, "Waiting for device to become active...");
-    delay(2);
-    als_ctrl.raw = this->reg((uint8_t) CommandRegisters::ALS_CONTR).get();
-  } while (!als_ctrl.active_mode && tries--);  // while active mode is not set - keep waiting
+  ESP_LOGV(TAG, "Setting mode and gain reg 0x%02X", als_ctrl.raw);
+  this->write_reg_(CommandRegisters::ALS_CONTR, als_ctrl.raw);
+}
 
-  if (!als_ctrl.active_mode) {
-    ESP_LOGW(TAG, "Failed to activate device");
+bool LTRAlsPsComponent::verify_als_configuration_(AlsGain gain, IntegrationTime time, bool active) {
+  // ALS_CONTR..MEAS_RATE are adjacent - single transaction
+  uint8_t buf[6]{0};
+  if (!this->read_regs_(CommandRegisters::ALS_CONTR, buf, sizeof(buf))) {
+    return false;
   }
+
+  AlsControlRegister als_ctrl{0};
+  als_ctrl.raw = buf[0];
+  MeasurementRateRegister meas{0};
+  meas.raw = buf[5];
+  return als_ctrl.active_mode == active && als_ctrl.gain == gain && meas.integration_time == time;
 }
+#endif
 
+#ifdef USE_LTR_PS
 void LTRAlsPsComponent::configure_ps_() {
-  PsMeasurementRateRegister ps_meas{0};
-  ps_meas.ps_measurement_rate = PsMeasurementRate::PS_MEAS_RATE_50MS;
-  this->reg((uint8_t) CommandRegisters::PS_MEAS_RATE) = ps_meas.raw;
-
+  // PS_CONTR..PS_MEAS_RATE are adjacent - single transaction
   PsControlRegister ps_ctrl{0};
   ps_ctrl.ps_mode_active = true;
   ps_ctrl.ps_mode_xxx = true;
-  this->reg((uint8_t) CommandRegisters::PS_CONTR) = ps_ctrl.raw;
+  ps_ctrl.ps_gain = this->ps_gain_;
+
+  PsLedRegister ps_led{0};
+  ps_led.ps_led_current = this->ps_led_current_;
+  ps_led.ps_led_duty = this->ps_led_duty_;
+  ps_led.ps_led_freq = this->ps_led_freq_;
+
+  PsNPulsesRegister ps_pulses{0};
+  ps_pulses.number_of_pulses = this->ps_pulses_;
+#ifdef USE_LTR_PS_LED_CONTROL
+  if (this->ps_led_control_.enabled) {
+    PsLedCurrent current;
+    uint8_t pulses;
+    this->ps_drive_for_level_(this->ps_led_control_.level, current, pulses);
+    ps_led.ps_led_current = current;
+    ps_pulses.number_of_pulses = pulses;
+  }
+#endif
+
+  PsMeasurementRateRegister ps_meas{0};
+  ps_meas.ps_measurement_rate = this->ps_measurement_rate_;
+
+  uint8_t buf[4] = {ps_ctrl.raw, ps_led.raw, ps_pulses.raw, ps_meas.raw};
+  this->write_regs_(CommandRegisters::PS_CONTR, buf, sizeof(buf));
+}
+#endif
+
+void LTRAlsPsComponent::configure_interrupt_persistence_() {
+  InterruptPersistRegister persist{0};
+#ifdef USE_LTR_PS
+  persist.ps_persist = this->ps_interrupt_persistence_;
+#endif
+#ifdef USE_LTR_ALS
+  persist.als_persist = this->als_interrupt_persistence_;
+#endif
+  this->write_reg_(CommandRegisters::INTERRUPT_PERSIST, persist.raw);
 }
 
-uint16_t LTRAlsPsComponent::read_ps_data_() {
-  AlsPsStatusRegister als_status{0};
-  als_status.raw = this->reg((uint8_t) CommandRegisters::ALS_PS_STATUS).get();
-  if (!als_status.ps_new_data || als_status.data_invalid) {
-    return this->ps_readings_;
+void LTRAlsPsComponent::configure_interrupts_() {
+  ESP_LOGV(TAG, "Configuring interrupts");
+  InterruptRegister interrupt{0};
+  interrupt.ps_interrupt = this->is_ps_interrupt_mode_();
+  interrupt.als_interrupt = this->is_als_report_on_change_();
+  interrupt.interrupt_polarity = false;  // active low, matches falling edge
+
+#ifdef USE_LTR_PS
+  if (this->is_ps_interrupt_mode_()) {
+    // ALS_PS_INTERRUPT is followed by PS thresholds - single transaction
+    uint16_t high = std::min<uint16_t>(this->ps_threshold_high_, 0x7ff);
+    uint16_t low = this->ps_threshold_low_;
+    uint8_t buf[5] = {interrupt.raw, (uint8_t) (high & 0xff), (uint8_t) (high >> 8), (uint8_t) (low & 0xff),
+                      (uint8_t) (low >> 8)};
+    this->write_regs_(CommandRegisters::ALS_PS_INTERRUPT, buf, sizeof(buf));
+    this->sync_ps_window_();
+    this->interrupt_pending_ = true;
+    return;
   }
+#endif
+  this->write_reg_(CommandRegisters::ALS_PS_INTERRUPT, interrupt.raw);
 
-  uint8_t ps_low = this->reg((uint8_t) CommandRegisters::PS_DATA_0).get();
-  PsData1Register ps_high;
-  ps_high.raw = this->reg((uint8_t) CommandRegisters::PS_DATA_1).get();
+  // read whatever is latched to get INT line released
+  this->interrupt_pending_ = true;
+}
 
-  uint16_t val = encode_uint16(ps_high.ps_data_high, ps_low);
-  //  ESP_LOGV(TAG, "Got sensor data: PS = %5d, Saturation flag = %d", val, ps_high.ps_saturation_flag);
-  if (ps_high.ps_saturation_flag) {
-    return 0x7ff;  // full 11 bit range
+#ifdef USE_LTR_PS
+void LTRAlsPsComponent::configure_ps_thresholds_(uint16_t low, uint16_t high) {
+  ESP_LOGV(TAG, "Setting proximity interrupt window: %d - %d", low, high);
+  // PS_THRES_UP_0..PS_THRES_LOW_1 are adjacent - single transaction
+  uint8_t buf[4] = {(uint8_t) (high & 0xff), (uint8_t) (high >> 8), (uint8_t) (low & 0xff), (uint8_t) (low >> 8)};
+  this->queue_regs_(CommandRegisters::PS_THRES_UP_0, buf, sizeof(buf));
+}
+
+void LTRAlsPsComponent::sync_ps_window_() {
+  // Window fields follow what the chip has, not what is queued: a write dropped after MAX_TRIES
+  // leaves them on the old window, so the next sample queues the new one again
+  uint8_t i = static_cast<uint8_t>(CommandRegisters::PS_THRES_UP_0) - SHADOW_BASE;
+  if (((this->shadow_valid_ >> i) & 0x0F) != 0x0F) {
+    return;
   }
-  return val;
+  this->ps_window_high_ = encode_uint16(this->shadow_[i + 1], this->shadow_[i]);
+  this->ps_window_low_ = encode_uint16(this->shadow_[i + 3], this->shadow_[i + 2]);
 }
+#endif
 
-void LTRAlsPsComponent::configure_gain_(AlsGain gain) {
+#ifdef USE_LTR_ALS
+bool LTRAlsPsComponent::configure_gain_(AlsGain gain, bool active) {
   AlsControlRegister als_ctrl{0};
-  als_ctrl.active_mode = true;
+  als_ctrl.active_mode = active;
   als_ctrl.gain = gain;
-  this->reg((uint8_t) CommandRegisters::ALS_CONTR) = als_ctrl.raw;
-  delay(2);
+  return this->write_reg_(CommandRegisters::ALS_CONTR, als_ctrl.raw);
+}
+
+void LTRAlsPsComponent::configure_als_window_(const AlsReadings &data) {
+  static const uint32_t MIN_WINDOW_COUNTS = 10;
 
-  AlsControlRegister read_als_ctrl{0};
-  read_als_ctrl.raw = this->reg((uint8_t) CommandRegisters::ALS_CONTR).get();
-  if (read_als_ctrl.gain != gain) {
-    ESP_LOGW(TAG, "Failed to set gain. We will try one more time.");
-    this->reg((uint8_t) CommandRegisters::ALS_CONTR) = als_ctrl.raw;
-    delay(2);
+  float delta = data.ch0 * this->als_window_percent_;
+  if (this->als_window_lux_ > 0.0f) {
+    // counts per lux are known from the last reading, so lux deadband translates to CH0 counts directly
+    delta = data.lux > 0.0f ? data.ch0 * this->als_window_lux_ / data.lux : 0.0f;
   }
+  uint32_t window = std::max<uint32_t>(delta, MIN_WINDOW_COUNTS);
+  uint16_t low = data.ch0 > window ? data.ch0 - window : 0;
+  uint16_t high = std::min<uint32_t>(data.ch0 + window, 0xffff);
+
+  ESP_LOGV(TAG, "Setting ALS interrupt window: %d - %d", low, high);
+  // ALS_THRES_UP_0..ALS_THRES_LOW_1 are adjacent - single transaction
+  uint8_t buf[4] = {(uint8_t) (high & 0xff), (uint8_t) (high >> 8), (uint8_t) (low & 0xff), (uint8_t) (low >> 8)};
+  this->write_regs_(CommandRegisters::ALS_THRES_UP_0, buf, sizeof(buf));
+  this->als_window_armed_ = true;
+  this->als_change_detected_ = false;
 }
 
-void LTRAlsPsComponent::configure_integration_time_(IntegrationTime time) {
+bool LTRAlsPsComponent::configure_integration_time_(IntegrationTime time) {
   MeasurementRateRegister meas{0};
   meas.measurement_repeat_rate = this->repeat_rate_;
   meas.integration_time = time;
-  this->reg((uint8_t) CommandRegisters::MEAS_RATE) = meas.raw;
-  delay(2);
-
-  MeasurementRateRegister read_meas{0};
-  read_meas.raw = this->reg((uint8_t) CommandRegisters::MEAS_RATE).get();
-  if (read_meas.integration_time != time) {
-    ESP_LOGW(TAG, "Failed to set integration time. We will try one more time.");
-    this->reg((uint8_t) CommandRegisters::MEAS_RATE) = meas.raw;
-    delay(2);
-  }
+  return this->write_reg_(CommandRegisters::MEAS_RATE, meas.raw);
 }
 
-DataAvail LTRAlsPsComponent::is_als_data_ready_(AlsReadings &data) {
-  AlsPsStatusRegister als_status{0};
-
-  als_status.raw = this->reg((uint8_t) CommandRegisters::ALS_PS_STATUS).get();
+DataAvail LTRAlsPsComponent::read_sensor_data_(AlsReadings &data) {
+  // Status first: new data bit reads 0 once the data registers were read ("0 = old data"), so
+  // it can't come from the same burst after them. PS data is adjacent to status and comes along.
+  AlsPsStatusRegister als_status = this->read_status_();
   if (!als_status.als_new_data)
     return DataAvail::NO_DATA;
 
+  // Data is read even if it gets rejected below, that marks the sample as old on the chip.
+  // CH1 low byte goes first - as per datasheet that latches both channels, so CH0 and CH1
+  // are guaranteed to come from the same integration cycle.
+  uint8_t buf[4]{0};
+  if (!this->read_regs_(CommandRegisters::ALS_DATA_CH1_0, buf, sizeof(buf))) {
+    ESP_LOGV(TAG, "Failed to read sensor data");
+    return DataAvail::NO_DATA;
+  }
+
   if (als_status.data_invalid) {
     ESP_LOGW(TAG, "Data available but not valid");
     return DataAvail::BAD_DATA;
@@ -381,22 +1457,23 @@ DataAvail LTRAlsPsComponent::is_als_data_ready_(AlsReadings &data) {
   ESP_LOGV(TAG, "Data ready, reported gain is %.0f", get_gain_coeff(als_status.gain));
   if (data.gain != als_status.gain) {
     ESP_LOGW(TAG, "Actual gain differs from requested (%.0f)", get_gain_coeff(data.gain));
-    return DataAvail::BAD_DATA;
+    return DataAvail::RANGE_MISMATCH;
   }
-  return DataAvail::DATA_OK;
-}
-
-void LTRAlsPsComponent::read_sensor_data_(AlsReadings &data) {
-  data.ch1 = 0;
-  data.ch0 = 0;
-  uint8_t ch1_0 = this->reg((uint8_t) CommandRegisters::ALS_DATA_CH1_0).get();
-  uint8_t ch1_1 = this->reg((uint8_t) CommandRegisters::ALS_DATA_CH1_1).get();
-  uint8_t ch0_0 = this->reg((uint8_t) CommandRegisters::ALS_DATA_CH0_0).get();
-  uint8_t ch0_1 = this->reg((uint8_t) CommandRegisters::ALS_DATA_CH0_1).get();
-  data.ch1 = encode_uint16(ch1_1, ch1_0);
-  data.ch0 = encode_uint16(ch0_1, ch0_0);
 
+  data.ch1 = encode_uint16(buf[1], buf[0]);
+  data.ch0 = encode_uint16(buf[3], buf[2]);
   ESP_LOGV(TAG, "Got sensor data: CH1 = %d, CH0 = %d", data.ch1, data.ch0);
+#ifdef USE_LTR_TRACE
+  if (this->trace_) {
+    auto &record = this->next_trace_record_();
+    record.ch0 = data.ch0;
+    record.ch1 = data.ch1;
+    record.gain = data.gain;
+    record.integration_time = data.integration_time;
+    record.als_valid = true;
+  }
+#endif
+  return DataAvail::DATA_OK;
 }
 
 bool LTRAlsPsComponent::are_adjustments_required_(AlsReadings &data) {
@@ -408,51 +1485,128 @@ bool LTRAlsPsComponent::are_adjustments_required_(AlsReadings &data) {
     ESP_LOGW(TAG, "Too many sensitivity adjustments done. Apparently, sensor reconfiguration fails. Stopping.");
     return false;
   }
-  data.number_of_adjustments++;
 
-  // Recommended thresholds as per datasheet
+  // Recommended thresholds as per datasheet. Re-ranging is triggered only outside of them,
+  // while new range aims well inside (TARGET_COUNTS), so next reading doesn't bounce around the edges.
   static const uint16_t LOW_INTENSITY_THRESHOLD = 1000;
   static const uint16_t HIGH_INTENSITY_THRESHOLD = 30000;
+  static const uint16_t TARGET_COUNTS = 20000;
   static const AlsGain GAINS[GAINS_COUNT] = {GAIN_1, GAIN_2, GAIN_4, GAIN_8, GAIN_48, GAIN_96};
   static const IntegrationTime INT_TIMES[TIMES_COUNT] = {
       INTEGRATION_TIME_50MS,  INTEGRATION_TIME_100MS, INTEGRATION_TIME_150MS, INTEGRATION_TIME_200MS,
       INTEGRATION_TIME_250MS, INTEGRATION_TIME_300MS, INTEGRATION_TIME_350MS, INTEGRATION_TIME_400MS};
 
-  if (data.ch0 <= LOW_INTENSITY_THRESHOLD) {
-    AlsGain next_gain = get_next(GAINS, data.gain);
-    if (next_gain != data.gain) {
-      data.gain = next_gain;
-      ESP_LOGV(TAG, "Low illuminance. Increasing gain.");
-      return true;
-    }
-    IntegrationTime next_time = get_next(INT_TIMES, data.integration_time);
-    if (next_time != data.integration_time) {
-      data.integration_time = next_time;
-      ESP_LOGV(TAG, "Low illuminance. Increasing integration time.");
-      return true;
-    }
-  } else if (data.ch0 >= HIGH_INTENSITY_THRESHOLD) {
-    AlsGain prev_gain = get_prev(GAINS, data.gain);
-    if (prev_gain != data.gain) {
-      data.gain = prev_gain;
-      ESP_LOGV(TAG, "High illuminance. Decreasing gain.");
-      return true;
-    }
-    IntegrationTime prev_time = get_prev(INT_TIMES, data.integration_time);
-    if (prev_time != data.integration_time) {
-      data.integration_time = prev_time;
-      ESP_LOGV(TAG, "High illuminance. Decreasing integration time.");
-      return true;
-    }
-  } else {
+  AlsGain new_gain = data.gain;
+  IntegrationTime new_time = data.integration_time;
+  uint16_t max_time_ms = get_meas_time_ms(this->repeat_rate_);
+
+  if (data.ch0 == 0xFFFF || data.ch1 == 0xFFFF) {
+    // Saturated reading tells nothing about actual intensity - go straight to the least sensitive
+    // setting, next reading will be a real one and we can predict from there
+    ESP_LOGV(TAG, "Saturated. Dropping sensitivity to minimum.");
+    new_gain = GAIN_1;
+    new_time = INTEGRATION_TIME_50MS;
+  } else if (data.ch0 > LOW_INTENSITY_THRESHOLD && data.ch0 < HIGH_INTENSITY_THRESHOLD) {
     ESP_LOGD(TAG, "Illuminance is good enough.");
     return false;
+  } else {
+    // Counts are proportional to gain * integration time, so we can predict reading for any
+    // other setting and jump there directly. Pick the most sensitive setting keeping the
+    // brighter channel under the target, prefer shorter integration time for the same sensitivity.
+    uint32_t current = (uint32_t) get_gain_coeff(data.gain) * get_itime_ms(data.integration_time);
+    uint32_t peak = std::max(data.ch0, data.ch1);
+    uint32_t best = 0;
+    new_gain = GAIN_1;
+    new_time = INTEGRATION_TIME_50MS;
+    for (auto gain : GAINS) {
+      for (auto time : INT_TIMES) {
+        uint16_t time_ms = get_itime_ms(time);
+        if (time_ms > max_time_ms)
+          continue;
+        uint32_t sensitivity = (uint32_t) get_gain_coeff(gain) * time_ms;
+        uint32_t predicted = peak * sensitivity / current;
+        if (predicted > TARGET_COUNTS || sensitivity < best)
+          continue;
+        if (sensitivity == best && time_ms >= get_itime_ms(new_time))
+          continue;
+        best = sensitivity;
+        new_gain = gain;
+        new_time = time;
+      }
+    }
+    ESP_LOGV(TAG, "%s illuminance. Predicted CH0 = %u", data.ch0 <= LOW_INTENSITY_THRESHOLD ? "Low" : "High",
+             (uint32_t) data.ch0 * best / current);
+  }
+
+  if (new_gain == data.gain && new_time == data.integration_time) {
+    ESP_LOGD(TAG, "Can't adjust sensitivity anymore.");
+    return false;
+  }
+  data.gain = new_gain;
+  data.integration_time = new_time;
+  data.number_of_adjustments++;
+  return true;
+}
+
+void LTRAlsPsComponent::prepare_lux_scale_table_() {
+  static const AlsGain GAINS[GAINS_COUNT] = {GAIN_1, GAIN_2, GAIN_4, GAIN_8, GAIN_48, GAIN_96};
+  for (auto gain : GAINS) {
+    for (uint8_t time = 0; time < TIMES_COUNT; time++) {
+      float scale = this->glass_attenuation_factor_ * 100.0f /
+                    (get_gain_coeff(gain) * get_itime_ms(static_cast<IntegrationTime>(time)));
+      this->lux_scale_q24_[get_gain_index(gain)][time] = lroundf(scale * (1 << 24));
+    }
   }
-  ESP_LOGD(TAG, "Can't adjust sensitivity anymore.");
-  return false;
 }
 
 void LTRAlsPsComponent::apply_lux_calculation_(AlsReadings &data) {
+  if (this->float_lux_reference_) {
+    this->apply_lux_calculation_float_(data);
+    return;
+  }
+
+  if ((data.ch0 == 0xFFFF) || (data.ch1 == 0xFFFF)) {
+    ESP_LOGW(TAG, "Sensors got saturated");
+    data.lux = 0.0f;
+    return;
+  }
+
+  if ((data.ch0 == 0x0000) && (data.ch1 == 0x0000)) {
+    ESP_LOGW(TAG, "Sensors blacked out");
+    data.lux = 0.0f;
+    return;
+  }
+
+  // Same equations as the floating point version, coefficients in Q14, ratio compared
+  // without division. Within 16 bit channels every branch stays below 2^32 once the ratio
+  // is known, the subtraction in the middle one may wrap in between but ends up exact.
+  uint32_t ch0 = data.ch0;
+  uint32_t ch1 = data.ch1;
+  uint32_t ratio_100 = 100 * ch1;
+  uint32_t sum = ch0 + ch1;
+  uint32_t lux_q14;
+  if (ratio_100 < 45 * sum) {
+    lux_q14 = 29070 * ch0 + 18119 * ch1;
+  } else if (ratio_100 < 64 * sum) {
+    lux_q14 = 70099 * ch0 - 32027 * ch1;
+  } else if (ratio_100 < 85 * sum) {
+    lux_q14 = 9709 * ch0 + 1942 * ch1;
+  } else {
+    ESP_LOGW(TAG, "Impossible ch1/(ch0 + ch1) ratio");
+    data.lux = 0.0f;
+    return;
+  }
+
+  // Q38 product is exact, the conversion to float is the only rounding step
+  uint32_t scale_q24 = this->lux_scale_q24_[get_gain_index(data.gain)][data.integration_time & 0b111];
+  uint64_t lux_q38 = (uint64_t) lux_q14 * scale_q24;
+  data.lux = (float) lux_q38 * (1.0f / (float) (1ULL << 38));
+
+  ESP_LOGV(TAG, "Lux calculation: ratio %u%%, gain %ux, int time %u ms, scale %u (Q24), lux %.3f", ratio_100 / sum,
+           (uint32_t) get_gain_coeff(data.gain), get_itime_ms(data.integration_time), scale_q24, data.lux);
+}
+
+void LTRAlsPsComponent::apply_lux_calculation_float_(AlsReadings &data) {
   if ((data.ch0 == 0xFFFF) || (data.ch1 == 0xFFFF)) {
     ESP_LOGW(TAG, "Sensors got saturated");
     data.lux = 0.0f;
@@ -489,29 +1643,350 @@ void LTRAlsPsComponent::apply_lux_calculation_(AlsReadings &data) {
   ESP_LOGV(TAG, "Lux calculation: ratio %.3f, gain %.0fx, int time %.1f, inv_pfactor %.3f, lux %.3f", ratio, als_gain,
            als_time, inv_pfactor, lux);
 }
+#endif
+
+#ifdef USE_LTR_ALS_AGGREGATION
+void LTRAlsPsComponent::add_als_sample_(const AlsReadings &data) {
+  this->als_last_sample_ = data;
+  this->als_readings_.number_of_adjustments = 0;
+  if (data.ch0 == 0xFFFF || data.ch1 == 0xFFFF) {
+    return;  // saturated sample carries no information about intensity
+  }
+
+  float lux = data.lux;
+  this->als_histogram_.push(std::lround(lux / ALS_HISTOGRAM_UNIT));
+  if (this->als_statistics_.count == 0) {
+    this->als_statistics_.min = lux;
+    this->als_statistics_.max = lux;
+  } else {
+    this->als_statistics_.min = std::min(this->als_statistics_.min, lux);
+    this->als_statistics_.max = std::max(this->als_statistics_.max, lux);
+  }
+  this->als_statistics_.sum += lux;
+  this->als_statistics_.count++;
+}
+
+void LTRAlsPsComponent::publish_als_aggregate_() {
+  if (this->als_statistics_.count == 0) {
+    ESP_LOGV(TAG, "No new ambient light samples");
+    return;
+  }
+  ESP_LOGD(TAG, "Ambient light: %u samples in the window", this->als_statistics_.count);
+
+  if (this->ambient_light_mean_sensor_ != nullptr) {
+    this->publish_state_(this->ambient_light_mean_sensor_, this->als_statistics_.sum / this->als_statistics_.count);
+  }
+  if (this->ambient_light_min_sensor_ != nullptr) {
+    this->publish_state_(this->ambient_light_min_sensor_, this->als_statistics_.min);
+  }
+  if (this->ambient_light_max_sensor_ != nullptr) {
+    this->publish_state_(this->ambient_light_max_sensor_, this->als_statistics_.max);
+  }
+  if (this->ambient_light_percentile_sensor_ != nullptr) {
+    this->publish_state_(this->ambient_light_percentile_sensor_,
+                         this->als_histogram_.percentile(this->als_percentile_) * ALS_HISTOGRAM_UNIT);
+  }
+  this->publish_data_part_1_(this->als_last_sample_);
+  this->publish_data_part_2_(this->als_last_sample_);
+  this->log_sample_stats_();
+  this->status_clear_warning();
+  this->als_statistics_ = {};
+  this->als_histogram_.clear();
+}
+#endif
+
+#ifdef USE_LTR_PS
+#ifdef USE_LTR_PS_CALIBRATION
+void LTRAlsPsComponent::restore_ps_offset_() {
+  this->ps_offset_pref_ =
+      global_preferences->make_preference<uint16_t>(fnv1_hash("ltr_als_ps_offset") ^ this->preference_hash_);
+  uint16_t offset;
+  if (this->ps_offset_pref_.load(&offset) && offset <= PS_OFFSET_MAX) {
+    ESP_LOGD(TAG, "Restored proximity offset %u", offset);
+    this->ps_calibration_.saved_offset = offset;
+    this->set_ps_offset_(offset);
+    return;
+  }
+  this->ps_calibration_.startup_samples = PS_CALIBRATION_SAMPLES;
+}
+
+bool LTRAlsPsComponent::calibrate_ps_(uint16_t ps_data) {
+  static const uint16_t MAX_DRIFT_STEP = 2;  // per tracking window
+  static const uint16_t SAVE_THRESHOLD = 8;  // spare the flash, small drift gets re-tracked after reboot anyway
+  auto &cal = this->ps_calibration_;
+  uint32_t now = millis();
+
+  if (ps_data == 0x7ff) {
+    // saturated, tells nothing about the baseline
+    cal.window_busy = true;
+    return cal.startup_samples == 0;
+  }
+  cal.window_min = std::min(cal.window_min, ps_data);
+
+  if (cal.startup_samples > 0) {
+    if (--cal.startup_samples > 0) {
+      return false;
+    }
+    // No object is expected at the first boot. Minimum is the best guess of the baseline - object only adds counts.
+    ESP_LOGI(TAG, "Proximity baseline is %u counts", cal.window_min);
+    this->set_ps_offset_((int32_t) cal.offset + cal.window_min - cal.margin);
+    cal.saved_offset = cal.offset;
+    this->ps_offset_pref_.save(&cal.offset);
+    cal.window_min = 0xffff;
+    cal.window_started_ms = now;
+    return false;  // this sample was taken with the old offset
+  }
+
+  if (ps_data > this->ps_threshold_high_) {
+    cal.window_busy = true;
+  }
+  if (cal.tracking_interval_ms == 0 || now - cal.window_started_ms < cal.tracking_interval_ms) {
+    return true;
+  }
+
+  if (!cal.window_busy) {
+    int32_t drift = (int32_t) cal.window_min - cal.margin;
+    if (cal.window_min == 0) {
+      drift = -MAX_DRIFT_STEP;  // baseline fell below the offset, we can't tell how far
+    }
+    drift = clamp<int32_t>(drift, -MAX_DRIFT_STEP, MAX_DRIFT_STEP);
+    if (drift != 0) {
+      ESP_LOGD(TAG, "Proximity baseline drifted, window minimum is %u", cal.window_min);
+      this->set_ps_offset_((int32_t) cal.offset + drift);
+    }
+    if (std::abs((int32_t) cal.offset - cal.saved_offset) >= SAVE_THRESHOLD) {
+      cal.saved_offset = cal.offset;
+      this->ps_offset_pref_.save(&cal.offset);
+    }
+  }
+  cal.window_min = 0xffff;
+  cal.window_busy = false;
+  cal.window_started_ms = now;
+  return true;
+}
+
+void LTRAlsPsComponent::set_ps_offset_(int32_t offset) {
+  uint16_t value = clamp<int32_t>(offset, 0, PS_OFFSET_MAX);
+  if (value == this->ps_calibration_.offset) {
+    return;
+  }
+  ESP_LOGD(TAG, "Proximity offset %u -> %u", this->ps_calibration_.offset, value);
+  this->ps_calibration_.offset = value;
+  this->configure_ps_offset_();
+}
+
+void LTRAlsPsComponent::configure_ps_offset_() {
+  // PS_OFFSET_1 (upper bits) goes first, PS_OFFSET_0 follows - single transaction
+  uint16_t offset = this->ps_calibration_.offset;
+  uint8_t buf[2] = {(uint8_t) (offset >> 8), (uint8_t) (offset & 0xff)};
+  this->queue_regs_(CommandRegisters::PS_OFFSET_1, buf, sizeof(buf));
+}
+#endif
+
+#ifdef USE_LTR_PS_PRESENCE
+void LTRAlsPsComponent::update_presence_(uint16_t ps_data, uint32_t now) {
+  auto &presence = this->presence_;
+  bool hit = presence.present ? ps_data < presence.exit_threshold : ps_data > presence.enter_threshold;
+  if (hit) {
+    presence.hit_ms[presence.hit_head++ & 15] = now;
+  }
+  presence.history = ((presence.history << 1) | hit) & ((1u << presence.window) - 1);
+
+  if (__builtin_popcount(presence.history) < presence.count || now - presence.changed_ms < presence.min_dwell_ms) {
+    return;
+  }
+  presence.present = !presence.present;
+  presence.changed_ms = now;
+  presence.history = 0;
+  // from the first of the latest count hits - they are all in the window, older ones may be left from before
+  uint32_t latency_ms = now - presence.hit_ms[(presence.hit_head - presence.count) & 15];
+  ESP_LOGD(TAG, "Presence %s, detected in %u ms (PS = %u)", presence.present ? "entered" : "left", latency_ms,
+           ps_data);
+  this->presence_binary_sensor_->publish_state(presence.present);
+  if (this->presence_latency_sensor_ != nullptr) {
+    this->publish_state_(this->presence_latency_sensor_, latency_ms);
+  }
+}
+#endif
+
+#ifdef USE_LTR_PS_LED_CONTROL
+void LTRAlsPsComponent::ps_drive_for_level_(uint8_t level, PsLedCurrent &current, uint8_t &pulses) const {
+  uint8_t max_current = std::min<uint8_t>(this->ps_led_current_, PsLedCurrent::PS_LED_CURRENT_100MA);
+  if (level < max_current) {
+    current = static_cast<PsLedCurrent>(level);
+    pulses = 1;
+  } else {
+    current = static_cast<PsLedCurrent>(max_current);
+    pulses = level - max_current + 1;
+  }
+}
+
+float LTRAlsPsComponent::ps_led_charge_uc_(uint8_t level) const {
+  // Each pulse keeps LED on for duty / frequency
+  PsLedCurrent current;
+  uint8_t pulses;
+  this->ps_drive_for_level_(level, current, pulses);
+  return (float) get_ps_led_current_ma(current) * pulses * get_ps_led_duty_percent(this->ps_led_duty_) / 100.0f /
+         get_ps_led_freq_khz(this->ps_led_freq_);
+}
+
+bool LTRAlsPsComponent::control_ps_led_(uint16_t &ps_data) {
+  static const uint8_t WINDOW_SAMPLES = 8;
+  static const uint16_t SATURATION_COUNTS = 1500;  // of 2047, reflection from close object needs headroom
+  static const uint16_t MIN_SIGNAL_COUNTS = 16;
+  static const uint8_t SNR_LOW = 4;
+  static const uint8_t SNR_HIGH = 16;
+  auto &ctrl = this->ps_led_control_;
+
+  if (ctrl.skip_sample) {
+    ctrl.skip_sample = false;
+    return false;
+  }
+  uint16_t raw = ps_data;
+  uint16_t diff = raw > ctrl.last_raw ? raw - ctrl.last_raw : ctrl.last_raw - raw;
+  ctrl.last_raw = raw;
+  // EWMA with 1/8 weight, x16 fixed point
+  ctrl.noise_q4 = ctrl.noise_q4 - (ctrl.noise_q4 >> 3) + (std::min<uint16_t>(diff, 0x7ff) << 1);
+  ctrl.window_min = std::min(ctrl.window_min, raw);
+  ctrl.window_max = std::max(ctrl.window_max, raw);
+
+  // Scale to full drive equivalent
+  float full_charge = this->ps_led_charge_uc_(ctrl.levels_count - 1);
+  float charge = this->ps_led_charge_uc_(ctrl.level);
+  ps_data = raw >= 0x7ff ? 0x7ff : std::min<uint32_t>(lroundf(raw * full_charge / charge), 0x7ff);
+
+  if (++ctrl.window_samples < WINDOW_SAMPLES) {
+    return true;
+  }
+
+  uint16_t noise = std::max<uint16_t>(ctrl.noise_q4 >> 4, 1);
+  uint8_t level = ctrl.level;
+  if (ctrl.window_max >= SATURATION_COUNTS) {
+    level = level > 0 ? level - 1 : 0;
+  } else if (ctrl.window_min < std::max<uint16_t>(SNR_LOW * noise, MIN_SIGNAL_COUNTS)) {
+    level = std::min<uint8_t>(level + 1, ctrl.levels_count - 1);
+  } else if (ctrl.window_min > std::max<uint16_t>(SNR_HIGH * noise, 4 * MIN_SIGNAL_COUNTS) && level > 0) {
+    // high threshold must stay resolvable above noise at the lower level
+    float lower = this->ps_led_charge_uc_(level - 1) / full_charge;
+    if (this->ps_threshold_high_ >= 0x7ff || this->ps_threshold_high_ * lower >= SNR_LOW * noise) {
+      level--;
+    }
+  }
+  ctrl.window_samples = 0;
+  ctrl.window_min = 0xffff;
+  ctrl.window_max = 0;
+
+  if (level != ctrl.level) {
+    ESP_LOGD(TAG, "Proximity LED level %u -> %u (%.3f uC per sample), noise %u counts", ctrl.level, level,
+             this->ps_led_charge_uc_(level), noise);
+    ctrl.level = level;
+    this->configure_ps_led_();
+  }
+  return true;
+}
+
+void LTRAlsPsComponent::configure_ps_led_() {
+  PsLedCurrent current;
+  uint8_t pulses;
+  this->ps_drive_for_level_(this->ps_led_control_.level, current, pulses);
+
+  // PS_LED and PS_N_PULSES are adjacent - single transaction
+  PsLedRegister ps_led{0};
+  ps_led.ps_led_current = current;
+  ps_led.ps_led_duty = this->ps_led_duty_;
+  ps_led.ps_led_freq = this->ps_led_freq_;
+  PsNPulsesRegister ps_pulses{0};
+  ps_pulses.number_of_pulses = pulses;
+  uint8_t buf[2] = {ps_led.raw, ps_pulses.raw};
+  this->queue_regs_(CommandRegisters::PS_LED, buf, sizeof(buf));
+  // queue is flushed before the next read, first sample after it is integrated partly with the old drive
+  this->ps_led_control_.skip_sample = true;
+}
+#endif
+
+void LTRAlsPsComponent::publish_ps_data_() {
+  if (!this->ps_updated_) {
+    ESP_LOGV(TAG, "No new proximity samples");
+    return;
+  }
+  this->ps_updated_ = false;
 
-void LTRAlsPsComponent::publish_data_part_1_(AlsReadings &data) {
   if (this->proximity_counts_sensor_ != nullptr) {
-    this->proximity_counts_sensor_->publish_state(this->ps_readings_);
+    this->publish_state_(this->proximity_counts_sensor_, this->ps_readings_);
+  }
+#ifdef USE_LTR_PS_LED_CONTROL
+  if (this->ps_led_charge_sensor_ != nullptr) {
+    this->publish_state_(this->ps_led_charge_sensor_, this->ps_led_charge_uc_(this->ps_led_control_.level));
   }
+#endif
+#ifdef USE_LTR_PS_STREAMING
+  ESP_LOGV(TAG, "Proximity: %u samples in the window", this->ps_statistics_.count);
+  if (this->proximity_min_sensor_ != nullptr) {
+    this->publish_state_(this->proximity_min_sensor_, this->ps_statistics_.min);
+  }
+  if (this->proximity_max_sensor_ != nullptr) {
+    this->publish_state_(this->proximity_max_sensor_, this->ps_statistics_.max);
+  }
+  if (this->proximity_mean_sensor_ != nullptr) {
+    this->publish_state_(this->proximity_mean_sensor_, (float) this->ps_statistics_.sum / this->ps_statistics_.count);
+  }
+  if (this->proximity_median_sensor_ != nullptr) {
+    this->publish_state_(this->proximity_median_sensor_, this->ps_histogram_.percentile(0.5f));
+  }
+  this->ps_statistics_ = {};
+  this->ps_histogram_.clear();
+#endif
+}
+#endif
+
+void LTRAlsPsComponent::publish_state_(sensor::Sensor *sensor, float value) {
+  for (auto &deadband : this->deadbands_) {
+    if (deadband.sensor != sensor)
+      continue;
+
+    uint32_t now = millis();
+    bool heartbeat_due = deadband.max_silence_ms > 0 && now - deadband.last_published_ms >= deadband.max_silence_ms;
+    if (!std::isnan(deadband.last_value) && !std::isnan(value) && !heartbeat_due) {
+      float threshold = std::max(deadband.absolute, deadband.relative * std::fabs(deadband.last_value));
+      if (std::fabs(value - deadband.last_value) <= threshold) {
+        ESP_LOGV(TAG, "'%s': %.3f is within deadband, not publishing", sensor->get_name().c_str(), value);
+        this->suppressed_publishes_++;
+        return;
+      }
+    }
+    deadband.last_value = value;
+    deadband.last_published_ms = now;
+    break;
+  }
+  sensor->publish_state(value);
+}
+
+#ifdef USE_LTR_ALS
+void LTRAlsPsComponent::publish_data_part_1_(AlsReadings &data) {
   if (this->ambient_light_sensor_ != nullptr) {
-    this->ambient_light_sensor_->publish_state(data.lux);
+    this->publish_state_(this->ambient_light_sensor_, data.lux);
   }
   if (this->infrared_counts_sensor_ != nullptr) {
-    this->infrared_counts_sensor_->publish_state(data.ch1);
+    this->publish_state_(this->infrared_counts_sensor_, data.ch1);
   }
   if (this->full_spectrum_counts_sensor_ != nullptr) {
-    this->full_spectrum_counts_sensor_->publish_state(data.ch0);
+    this->publish_state_(this->full_spectrum_counts_sensor_, data.ch0);
   }
 }
 
 void LTRAlsPsComponent::publish_data_part_2_(AlsReadings &data) {
   if (this->actual_gain_sensor_ != nullptr) {
-    this->actual_gain_sensor_->publish_state(get_gain_coeff(data.gain));
+    this->publish_state_(this->actual_gain_sensor_, get_gain_coeff(data.gain));
   }
   if (this->actual_integration_time_sensor_ != nullptr) {
-    this->actual_integration_time_sensor_->publish_state(get_itime_ms(data.integration_time));
+    this->publish_state_(this->actual_integration_time_sensor_, get_itime_ms(data.integration_time));
+  }
+#ifdef USE_LTR_DIAGNOSTICS
+  if (this->settle_time_sensor_ != nullptr) {
+    this->publish_state_(this->settle_time_sensor_, this->cycle_timing_.settle_time_ms);
   }
+#endif
 }
+#endif
 }  // namespace ltr_als_ps
 }  // namespace esphome
@@ -3,15 +3,29 @@
 #include "esphome/components/i2c/i2c.h"
 #include "esphome/components/sensor/sensor.h"
 #include "esphome/core/component.h"
+#include "esphome/core/defines.h"
+#ifdef USE_LTR_PS_PRESENCE
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#endif
+#ifdef USE_LTR_DIAGNOSTICS_TEXT
+#include "esphome/components/text_sensor/text_sensor.h"
+#endif
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
 #include "esphome/core/optional.h"
+#include "esphome/core/preferences.h"
 #include "esphome/core/automation.h"
 
 #include "ltr_definitions.h"
+#include "ltr_statistics.h"
+
+#include <cmath>
+#include <vector>
 
 namespace esphome {
 namespace ltr_als_ps {
 
-enum DataAvail : uint8_t { NO_DATA, BAD_DATA, DATA_OK };
+enum DataAvail : uint8_t { NO_DATA, BAD_DATA, RANGE_MISMATCH, DATA_OK };
 
 enum LtrType : uint8_t {
   LTR_TYPE_UNKNOWN = 0,
@@ -20,6 +34,30 @@ enum LtrType : uint8_t {
   LTR_TYPE_ALS_AND_PS = 3,
 };
 
+//
+// Coordinates several sensors sharing one physical I2C bus. Measurement cycles are spread
+// over a frame, one slot per sensor, and speculative status polls are rationed so that
+// only a few sensors hit the bus in one loop() round. Every mux channel is a bus object of
+// its own, so sensors behind a mux are given the root bus with set_shared_bus().
+//
+class LTRBusScheduler {
+ public:
+  static LTRBusScheduler *get_for_bus(i2c::I2CBus *bus);
+
+  uint8_t add_member();
+  uint8_t size() const { return this->last_round_.size(); }
+  bool try_poll(uint8_t slot);
+  uint32_t get_start_delay(uint8_t slot, uint32_t frame_ms) const;
+
+ protected:
+  explicit LTRBusScheduler(i2c::I2CBus *bus) : bus_(bus) {}
+
+  i2c::I2CBus *bus_;
+  std::vector<uint32_t> last_round_;  // per member, loop() round when it asked to poll last time
+  uint32_t round_{0};
+  uint8_t cursor_{0};
+};
+
 class LTRAlsPsComponent : public PollingComponent, public i2c::I2CDevice {
  public:
   //
@@ -34,7 +72,15 @@ class LTRAlsPsComponent : public PollingComponent, public i2c::I2CDevice {
   // Configuration setters : General
   //
   void set_ltr_type(LtrType type) { this->ltr_type_ = type; }
+  void set_interrupt_pin(InternalGPIOPin *pin) { this->interrupt_pin_ = pin; }
+  void set_shared_bus(i2c::I2CBus *bus) { this->shared_bus_ = bus; }
+  // Keys saved state to this instance, the address alone is not unique behind a mux
+  void set_preference_id(const std::string &id) { this->preference_hash_ = fnv1_hash(id); }
+#ifdef USE_LTR_TRACE
+  void set_trace(bool trace) { this->trace_ = trace; }
+#endif
 
+#ifdef USE_LTR_ALS
   // Configuration setters : ALS
   //
   void set_als_auto_mode(bool enable) { this->automatic_mode_enabled_ = enable; }
@@ -42,22 +88,118 @@ class LTRAlsPsComponent : public PollingComponent, public i2c::I2CDevice {
   void set_als_integration_time(IntegrationTime time) { this->integration_time_ = time; }
   void set_als_meas_repeat_rate(MeasurementRepeatRate rate) { this->repeat_rate_ = rate; }
   void set_als_glass_attenuation_factor(float factor) { this->glass_attenuation_factor_ = factor; }
+  void set_als_float_lux_reference(bool enable) { this->float_lux_reference_ = enable; }
+  void set_als_report_on_change_percent(float percent) { this->als_window_percent_ = percent; }
+  void set_als_report_on_change_lux(float lux) { this->als_window_lux_ = lux; }
+  void set_als_interrupt_persistence(uint8_t persistence) { this->als_interrupt_persistence_ = persistence; }
+#endif
+#ifdef USE_LTR_ALS_AGGREGATION
+  void set_als_percentile(float percentile) { this->als_percentile_ = percentile; }
+#endif
+#ifdef USE_LTR_ALS_STANDBY
+  void set_als_standby(bool standby) { this->als_standby_ = standby; }
+  void set_als_active_time_sensor(sensor::Sensor *sensor) { this->als_active_time_sensor_ = sensor; }
+#endif
+#ifdef USE_LTR_ADAPTIVE_SAMPLING
+  void set_adaptive_sampling(uint32_t min_interval_ms, uint32_t max_interval_ms, float change_threshold) {
+    this->adaptive_.min_interval_ms = min_interval_ms;
+    this->adaptive_.max_interval_ms = max_interval_ms;
+    this->adaptive_.change_threshold = change_threshold;
+  }
+#endif
 
+#ifdef USE_LTR_PS
   // Configuration setters : PS
   //
   void set_ps_high_threshold(uint16_t threshold) { this->ps_threshold_high_ = threshold; }
   void set_ps_low_threshold(uint16_t threshold) { this->ps_threshold_low_ = threshold; }
   void set_ps_cooldown_time_s(uint16_t time) { this->ps_cooldown_time_s_ = time; }
   void set_ps_gain(PsGain gain) { this->ps_gain_ = gain; }
+  void set_ps_measurement_rate(PsMeasurementRate rate) { this->ps_measurement_rate_ = rate; }
+  void set_ps_interrupt_persistence(uint8_t persistence) { this->ps_interrupt_persistence_ = persistence; }
+  void set_ps_led_current(PsLedCurrent current) { this->ps_led_current_ = current; }
+  void set_ps_led_duty(PsLedDuty duty) { this->ps_led_duty_ = duty; }
+  void set_ps_led_frequency(PsLedFreq freq) { this->ps_led_freq_ = freq; }
+  void set_ps_pulses(uint8_t pulses) { this->ps_pulses_ = pulses; }
+#endif
+#ifdef USE_LTR_PS_LED_CONTROL
+  void set_ps_led_control(bool enable) { this->ps_led_control_.enabled = enable; }
+  void set_ps_led_charge_sensor(sensor::Sensor *sensor) { this->ps_led_charge_sensor_ = sensor; }
+#endif
+#ifdef USE_LTR_PS_PRESENCE
+  void set_presence_binary_sensor(binary_sensor::BinarySensor *sensor) { this->presence_binary_sensor_ = sensor; }
+  void set_presence_latency_sensor(sensor::Sensor *sensor) { this->presence_latency_sensor_ = sensor; }
+  void set_presence(uint16_t enter_threshold, uint16_t exit_threshold, uint8_t count, uint8_t window,
+                    uint32_t min_dwell_ms) {
+    this->presence_.enter_threshold = enter_threshold;
+    this->presence_.exit_threshold = exit_threshold;
+    this->presence_.count = count;
+    this->presence_.window = window;
+    this->presence_.min_dwell_ms = min_dwell_ms;
+  }
+#endif
+#ifdef USE_LTR_PS_CALIBRATION
+  void set_ps_calibration(uint16_t margin, uint32_t tracking_interval_ms) {
+    this->ps_calibration_.enabled = true;
+    this->ps_calibration_.margin = margin;
+    this->ps_calibration_.tracking_interval_ms = tracking_interval_ms;
+  }
+#endif
 
   // Sensors setters
   //
+#ifdef USE_LTR_ALS
   void set_ambient_light_sensor(sensor::Sensor *sensor) { this->ambient_light_sensor_ = sensor; }
   void set_full_spectrum_counts_sensor(sensor::Sensor *sensor) { this->full_spectrum_counts_sensor_ = sensor; }
   void set_infrared_counts_sensor(sensor::Sensor *sensor) { this->infrared_counts_sensor_ = sensor; }
   void set_actual_gain_sensor(sensor::Sensor *sensor) { this->actual_gain_sensor_ = sensor; }
   void set_actual_integration_time_sensor(sensor::Sensor *sensor) { this->actual_integration_time_sensor_ = sensor; }
+#endif
+#ifdef USE_LTR_DIAGNOSTICS
+  void set_i2c_transactions_sensor(sensor::Sensor *sensor) { this->i2c_transactions_sensor_ = sensor; }
+  void set_i2c_errors_sensor(sensor::Sensor *sensor) { this->i2c_errors_sensor_ = sensor; }
+  void set_max_loop_time_sensor(sensor::Sensor *sensor) { this->max_loop_time_sensor_ = sensor; }
+#ifdef USE_LTR_ALS
+  void set_settle_time_sensor(sensor::Sensor *sensor) { this->settle_time_sensor_ = sensor; }
+  void set_data_timeouts_sensor(sensor::Sensor *sensor) { this->data_timeouts_sensor_ = sensor; }
+  void set_bad_data_sensor(sensor::Sensor *sensor) { this->bad_data_sensor_ = sensor; }
+  void set_stale_data_sensor(sensor::Sensor *sensor) { this->stale_data_sensor_ = sensor; }
+  void set_auto_range_adjustments_sensor(sensor::Sensor *sensor) { this->auto_range_adjustments_sensor_ = sensor; }
+#endif
+#ifdef USE_LTR_DIAGNOSTICS_TEXT
+  void set_state_times_text_sensor(text_sensor::TextSensor *sensor) { this->state_times_text_sensor_ = sensor; }
+  void set_auto_range_histogram_text_sensor(text_sensor::TextSensor *sensor) {
+    this->auto_range_histogram_text_sensor_ = sensor;
+  }
+#endif
+#endif
+#ifdef USE_LTR_ALS_AGGREGATION
+  void set_ambient_light_mean_sensor(sensor::Sensor *sensor) { this->ambient_light_mean_sensor_ = sensor; }
+  void set_ambient_light_min_sensor(sensor::Sensor *sensor) { this->ambient_light_min_sensor_ = sensor; }
+  void set_ambient_light_max_sensor(sensor::Sensor *sensor) { this->ambient_light_max_sensor_ = sensor; }
+  void set_ambient_light_percentile_sensor(sensor::Sensor *sensor) { this->ambient_light_percentile_sensor_ = sensor; }
+#endif
+#ifdef USE_LTR_PS
   void set_proximity_counts_sensor(sensor::Sensor *sensor) { this->proximity_counts_sensor_ = sensor; }
+#endif
+#ifdef USE_LTR_PS_STREAMING
+  void set_proximity_min_sensor(sensor::Sensor *sensor) { this->proximity_min_sensor_ = sensor; }
+  void set_proximity_max_sensor(sensor::Sensor *sensor) { this->proximity_max_sensor_ = sensor; }
+  void set_proximity_mean_sensor(sensor::Sensor *sensor) { this->proximity_mean_sensor_ = sensor; }
+  void set_proximity_median_sensor(sensor::Sensor *sensor) { this->proximity_median_sensor_ = sensor; }
+
+  // Raw PS stream, called for every new sample right from the loop(). Keep it short.
+  void add_on_ps_sample_callback(std::function<void(uint16_t)> &&callback) {
+    this->on_ps_sample_callback_.add(std::move(callback));
+  }
+#endif
+  void set_suppressed_publishes_sensor(sensor::Sensor *sensor) { this->suppressed_publishes_sensor_ = sensor; }
+
+  // Publish suppression: value is published only when it differs from the last published one
+  // by more than max(absolute, relative * last), or when sensor stayed silent for max_silence_ms
+  void set_sensor_deadband(sensor::Sensor *sensor, float absolute, float relative, uint32_t max_silence_ms) {
+    this->deadbands_.push_back({sensor, absolute, relative, max_silence_ms});
+  }
 
  protected:
   //
@@ -67,16 +209,41 @@ class LTRAlsPsComponent : public PollingComponent, public i2c::I2CDevice {
   enum class State : uint8_t {
     NOT_INITIALIZED,
     DELAYED_SETUP,
+    VERIFYING_RESET,
+    IDENTIFYING_PART,
+    CONFIGURING_ALS,
+    CONFIGURING_ALS_TIMING,
+    VERIFYING_ALS,
+    CONFIGURING_PS,
+    CONFIGURING_INTERRUPTS,
+    ENABLING_INTERRUPTS,
+    SETUP_IN_PROGRESS,
     IDLE,
+    WAKING_UP_ALS,
     WAITING_FOR_DATA,
-    COLLECTING_DATA_AUTO,
     DATA_COLLECTED,
+    APPLYING_INTEGRATION_TIME,
+    APPLYING_GAIN,
     ADJUSTMENT_IN_PROGRESS,
+    WAITING_FOR_NEXT_SAMPLE,
     READY_TO_PUBLISH,
-    KEEP_PUBLISHING
+    KEEP_PUBLISHING  // keep last, used for diagnostics table size
   } state_{State::NOT_INITIALIZED};
+  uint8_t tries_{0};
+#ifdef USE_LTR_ALS
+  uint32_t data_wait_started_ms_{0};  // first poll which found no data
+#endif
+
+  i2c::I2CBus *shared_bus_{nullptr};  // physical bus when behind a mux, bus_ is the mux channel
+  LTRBusScheduler *bus_scheduler_{nullptr};
+  uint8_t bus_slot_{0};
 
-  LtrType ltr_type_{LtrType::LTR_TYPE_ALS_ONLY};
+  void set_state_after_(State state, uint32_t delay_ms);
+  State next_setup_state_(State state) const;
+
+  LtrType ltr_type_{LtrType::LTR_TYPE_ALS_ONLY};  // configured, narrowed down to what the part has
+  const char *part_name_{nullptr};
+  uint32_t preference_hash_{0};  // of the component id, mixed into preference keys
 
   //
   // Current measurements data
@@ -88,67 +255,506 @@ class LTRAlsPsComponent : public PollingComponent, public i2c::I2CDevice {
     IntegrationTime integration_time{IntegrationTime::INTEGRATION_TIME_100MS};
     float lux{0.0f};
     uint8_t number_of_adjustments{0};
-  } als_readings_;
+  };
+#ifdef USE_LTR_ALS
+  AlsReadings als_readings_;
+#endif
+#ifdef USE_LTR_PS
   uint16_t ps_readings_{0xfffe};
+  bool ps_updated_{false};  // new sample since last publish
+#endif
 
+  // Codegen defines USE_LTR_ALS / USE_LTR_PS only for the features used by any instance
+  // in the build, everything else compiles out together with the branches checking it
   inline bool is_als_() const {
+#ifdef USE_LTR_ALS
     return this->ltr_type_ == LtrType::LTR_TYPE_ALS_ONLY || this->ltr_type_ == LtrType::LTR_TYPE_ALS_AND_PS;
+#else
+    return false;
+#endif
   }
   inline bool is_ps_() const {
+#ifdef USE_LTR_PS
     return this->ltr_type_ == LtrType::LTR_TYPE_PS_ONLY || this->ltr_type_ == LtrType::LTR_TYPE_ALS_AND_PS;
+#else
+    return false;
+#endif
   }
 
   //
   // Device interaction and data manipulation
   //
-  bool check_part_number_();
+  bool check_part_number_();  // and drop the parts of the config chip doesn't have
+
+  uint8_t read_reg_(CommandRegisters reg);
+  bool read_regs_(CommandRegisters start, uint8_t *data, uint8_t len);
+  bool write_reg_(CommandRegisters reg, uint8_t value);
+  bool write_regs_(CommandRegisters start, const uint8_t *data, uint8_t len);
+
+  //
+  // Shadow copy of writable registers ALS_CONTR..INTERRUPT_PERSIST. Writes of values chip already has
+  // are skipped, reads refresh the copy. Invalidated when chip is reset or doesn't behave as expected.
+  //
+  static const uint8_t SHADOW_BASE = static_cast<uint8_t>(CommandRegisters::ALS_CONTR);
+  static const uint8_t SHADOW_SIZE = static_cast<uint8_t>(CommandRegisters::INTERRUPT_PERSIST) - SHADOW_BASE + 1;
+  // 0x80-0x85, 0x8F-0x95, 0x97-0x9A, 0x9E
+  static const uint32_t SHADOW_WRITABLE = 0x0000003Fu | 0x003F8000u | 0x07800000u | 0x40000000u;
+  uint8_t shadow_[SHADOW_SIZE]{};
+  uint32_t shadow_valid_{0};  // bit per register
+
+  void update_shadow_(CommandRegisters start, const uint8_t *data, uint8_t len, bool valid);
+  void invalidate_shadow_() { this->shadow_valid_ = 0; }
+
+  //
+  // Deferred writes. Decisions made while handling a sample (interrupt window, PS offset, LED drive) are
+  // queued instead of adding a second transaction to the pass. Queue is flushed one contiguous run per
+  // loop() pass before the state machine gets its turn; later values for the same register replace queued ones.
+  //
+  uint8_t pending_[SHADOW_SIZE]{};
+  uint32_t pending_mask_{0};  // bit per register
+  uint8_t pending_failures_{0};
 
-  void configure_reset_();
+  void queue_regs_(CommandRegisters start, const uint8_t *data, uint8_t len);
+  void flush_pending_regs_();
+
+  bool configure_reset_();
+  void configure_interrupt_persistence_();
+  void configure_interrupts_();
+  AlsPsStatusRegister read_status_();
+  AlsPsStatusRegister poll_ps_();
+  void publish_state_(sensor::Sensor *sensor, float value);
+
+#ifdef USE_LTR_ALS
   void configure_als_();
-  void configure_integration_time_(IntegrationTime time);
-  void configure_gain_(AlsGain gain);
-  DataAvail is_als_data_ready_(AlsReadings &data);
-  void read_sensor_data_(AlsReadings &data);
+  bool verify_als_configuration_(AlsGain gain, IntegrationTime time, bool active);
+  bool configure_integration_time_(IntegrationTime time);
+  bool configure_gain_(AlsGain gain, bool active = true);
+  void configure_als_window_(const AlsReadings &data);
+  void start_als_cycle_();
+  DataAvail read_sensor_data_(AlsReadings &data);
   bool are_adjustments_required_(AlsReadings &data);
   void apply_lux_calculation_(AlsReadings &data);
+  void apply_lux_calculation_float_(AlsReadings &data);
+  void prepare_lux_scale_table_();
   void publish_data_part_1_(AlsReadings &data);
   void publish_data_part_2_(AlsReadings &data);
+#endif
+#ifdef USE_LTR_ALS_AGGREGATION
+  void add_als_sample_(const AlsReadings &data);
+  void publish_als_aggregate_();
+#endif
+#ifdef USE_LTR_ADAPTIVE_SAMPLING
+  bool adapt_sampling_rate_(float lux);
+#endif
 
+#ifdef USE_LTR_PS
   void configure_ps_();
-  uint16_t read_ps_data_();
-  void check_and_trigger_ps_();
+  void configure_ps_thresholds_(uint16_t low, uint16_t high);
+  void sync_ps_window_();
+  void process_ps_data_(uint16_t ps_data);
+  void publish_ps_data_();
+#endif
+
+  uint32_t setup_time_ms_{0};
+  bool first_sample_published_{false};
+
+  void run_state_machine_();
+  void log_sample_stats_();
+
+#ifdef USE_LTR_DIAGNOSTICS
+  //
+  // Diagnostics, compiled in only when any diagnostic output is configured.
+  // Bus usage and cycle timing are reset after each published sample,
+  // per-minute counters - after each diagnostics publish, totals are never reset.
+  //
+  struct BusUsage {
+    uint32_t transactions{0};
+    uint32_t bytes{0};
+  } bus_usage_;
+
+  struct CycleTiming {
+    uint32_t started_ms{0};        // when data collection was initiated
+    uint32_t loop_time_us{0};      // total time spent in loop() since previous sample
+    uint32_t max_loop_time_us{0};  // longest single loop() pass since previous sample
+    uint32_t settle_time_ms{0};    // from cycle start till auto-ranging is done
+  } cycle_timing_;
+
+  static const uint8_t STATES_COUNT = static_cast<uint8_t>(State::KEEP_PUBLISHING) + 1;
+  static const uint8_t ADJUSTMENT_BUCKETS = 6;  // 0, 1, 2, 3, 4, 5+ adjustments per sample
+  struct Diagnostics {
+    uint32_t i2c_transactions{0};  // per minute
+    uint32_t i2c_errors{0};        // per minute
+    uint32_t max_loop_time_us{0};  // per minute
+    uint32_t state_time_us[STATES_COUNT]{};
+    uint32_t data_timeouts{0};  // totals
+    uint32_t bad_data{0};
+    uint32_t stale_data{0};
+    uint32_t adjustments[ADJUSTMENT_BUCKETS]{};
+  } diagnostics_;
+
+  sensor::Sensor *i2c_transactions_sensor_{nullptr};
+  sensor::Sensor *i2c_errors_sensor_{nullptr};
+  sensor::Sensor *max_loop_time_sensor_{nullptr};
+#ifdef USE_LTR_ALS
+  sensor::Sensor *settle_time_sensor_{nullptr};  // time from cycle start till data is ready to publish
+  sensor::Sensor *data_timeouts_sensor_{nullptr};
+  sensor::Sensor *bad_data_sensor_{nullptr};
+  sensor::Sensor *stale_data_sensor_{nullptr};
+  sensor::Sensor *auto_range_adjustments_sensor_{nullptr};  // mean adjustments per sample
+#endif
+#ifdef USE_LTR_DIAGNOSTICS_TEXT
+  text_sensor::TextSensor *state_times_text_sensor_{nullptr};           // per minute, busiest state first
+  text_sensor::TextSensor *auto_range_histogram_text_sensor_{nullptr};  // totals
+#endif
+
+  void publish_diagnostics_();
+  static const char *state_name_(State state);
+#endif
+
+  inline void account_bus_transaction_(uint8_t bytes, bool ok) {
+#ifdef USE_LTR_DIAGNOSTICS
+    this->bus_usage_.transactions++;
+    this->bus_usage_.bytes += bytes;
+    this->diagnostics_.i2c_transactions++;
+    if (!ok)
+      this->diagnostics_.i2c_errors++;
+#endif
+  }
 
   //
   // Component configuration
   //
+#ifdef USE_LTR_ALS
   bool automatic_mode_enabled_{true};
   AlsGain gain_{AlsGain::GAIN_1};
   IntegrationTime integration_time_{IntegrationTime::INTEGRATION_TIME_100MS};
   MeasurementRepeatRate repeat_rate_{MeasurementRepeatRate::REPEAT_RATE_500MS};
   float glass_attenuation_factor_{1.0};
+  bool float_lux_reference_{false};
+  // glass_attenuation_factor / (gain * integration_time / 100ms) for every gain and time, Q24.
+  // Fits 32 bits for glass factors up to 100, which is what the config schema allows.
+  uint32_t lux_scale_q24_[GAINS_COUNT][TIMES_COUNT]{};
+  float als_window_percent_{0.0f};
+  float als_window_lux_{0.0f};
 
+  // Range auto-ranging settled on, restored on boot so the first sample doesn't need re-ranging
+  struct SettledRange {
+    AlsGain gain;
+    IntegrationTime integration_time;
+  } __attribute__((packed));
+  SettledRange saved_range_{AlsGain::GAIN_1, IntegrationTime::INTEGRATION_TIME_100MS};
+  ESPPreferenceObject range_pref_;
+
+  void restore_als_range_();
+  void save_als_range_(const AlsReadings &data);
+  uint8_t als_interrupt_persistence_{0};
+#endif
+
+#ifdef USE_LTR_PS
   uint16_t ps_cooldown_time_s_{5};
+  uint32_t ps_last_high_trigger_time_{0};
+  uint32_t ps_last_low_trigger_time_{0};
   PsGain ps_gain_{PsGain::PS_GAIN_16};
+  PsMeasurementRate ps_measurement_rate_{PsMeasurementRate::PS_MEAS_RATE_50MS};
   uint16_t ps_threshold_high_{0xffff};
   uint16_t ps_threshold_low_{0x0000};
+  uint8_t ps_interrupt_persistence_{0};
+  PsLedCurrent ps_led_current_{PsLedCurrent::PS_LED_CURRENT_100MA};  // datasheet defaults
+  PsLedDuty ps_led_duty_{PsLedDuty::PS_LED_DUTY_100};
+  PsLedFreq ps_led_freq_{PsLedFreq::PS_LED_FREQ_60KHZ};
+  uint8_t ps_pulses_{1};
+#endif
+
+  //
+  // Presence engine, evaluated on every PS sample. State flips when count of the last window samples are
+  // on the other side of the threshold (enter when absent, exit when present), but not sooner than
+  // min dwell after the previous flip. Latency is from the first of those samples to the flip.
+  //
+#ifdef USE_LTR_PS_PRESENCE
+  struct PsPresence {
+    uint16_t enter_threshold{0xffff};
+    uint16_t exit_threshold{0};
+    uint8_t count{1};
+    uint8_t window{1};  // up to 16
+    uint32_t min_dwell_ms{0};
+    uint16_t history{0};  // bit per sample, newest in bit 0
+    bool present{false};
+    uint32_t changed_ms{0};
+    uint32_t hit_ms[16]{};  // times of the latest hits, ring
+    uint8_t hit_head{0};
+  } presence_;
+  binary_sensor::BinarySensor *presence_binary_sensor_{nullptr};
+  sensor::Sensor *presence_latency_sensor_{nullptr};
+
+  void update_presence_(uint16_t ps_data, uint32_t now);
+#endif
+
+  bool is_ps_presence_() const {
+#ifdef USE_LTR_PS_PRESENCE
+    return this->presence_binary_sensor_ != nullptr;
+#else
+    return false;
+#endif
+  }
+
+  //
+  // PS LED drive control. Configured current and pulses are the ceiling, drive levels go from 5 mA x 1 pulse
+  // up to it. Controller keeps signal to noise ratio of raw counts within a band, evaluated every few samples.
+  // Readings are scaled back to the full drive, so thresholds keep their meaning at any level.
+  //
+#ifdef USE_LTR_PS_LED_CONTROL
+  struct PsLedControl {
+    bool enabled{false};
+    uint8_t level{0};
+    uint8_t levels_count{1};
+    uint16_t noise_q4{0};  // mean difference between consecutive raw samples, x16
+    uint16_t last_raw{0};
+    uint16_t window_min{0xffff};
+    uint16_t window_max{0};
+    uint8_t window_samples{0};
+    bool skip_sample{false};  // taken while drive was changing
+  } ps_led_control_;
+  sensor::Sensor *ps_led_charge_sensor_{nullptr};  // uC per sample
+
+  void ps_drive_for_level_(uint8_t level, PsLedCurrent &current, uint8_t &pulses) const;
+  float ps_led_charge_uc_(uint8_t level) const;
+  bool control_ps_led_(uint16_t &ps_data);
+  void configure_ps_led_();
+#endif
+
+  //
+  // PS crosstalk calibration. Chip subtracts PS_OFFSET from every reading, offset is chosen so that
+  // no-object baseline (minimum seen) sits at the margin. Measured once on first boot, then follows
+  // slow drift in windows with no object, a few counts per window at most.
+  //
+#ifdef USE_LTR_PS_CALIBRATION
+  struct PsCalibration {
+    bool enabled{false};
+    uint16_t margin{10};
+    uint32_t tracking_interval_ms{0};  // 0 - no tracking
+    uint16_t offset{0};                // 10 bit, as programmed
+    uint16_t saved_offset{0xffff};
+    uint8_t startup_samples{0};  // still to collect, 0 - startup calibration done
+    uint16_t window_min{0xffff};
+    bool window_busy{false};  // object was close during the window
+    uint32_t window_started_ms{0};
+  } ps_calibration_;
+  ESPPreferenceObject ps_offset_pref_;
+
+  void restore_ps_offset_();
+  bool calibrate_ps_(uint16_t ps_data);
+  void set_ps_offset_(int32_t offset);
+  void configure_ps_offset_();
+#endif
+
+  bool is_ps_calibrating_() const {
+#ifdef USE_LTR_PS_CALIBRATION
+    return this->ps_calibration_.startup_samples > 0;
+#else
+    return false;
+#endif
+  }
+
+  //
+  // Interrupt handling. When pin is configured, PS thresholds are checked
+  // by the chip itself and we touch the bus only when INT is asserted.
+  // In report-on-change mode ALS window is checked by the chip as well.
+  //
+  InternalGPIOPin *interrupt_pin_{nullptr};
+  volatile bool interrupt_pending_{false};
+#ifdef USE_LTR_PS
+  uint16_t ps_window_low_{0};
+  uint16_t ps_window_high_{0};
+#endif
+#ifdef USE_LTR_ALS
+  bool als_window_armed_{false};
+  bool als_change_detected_{false};
+#endif
+
+  static void gpio_intr(LTRAlsPsComponent *arg);
+  inline bool is_ps_interrupt_mode_() const { return this->interrupt_pin_ != nullptr && this->is_ps_(); }
+  inline bool is_als_report_on_change_() const {
+#ifdef USE_LTR_ALS
+    return this->is_als_() && (this->als_window_percent_ > 0.0f || this->als_window_lux_ > 0.0f);
+#else
+    return false;
+#endif
+  }
 
   //
   //   Sensors for publishing data
   //
+#ifdef USE_LTR_ALS
   sensor::Sensor *infrared_counts_sensor_{nullptr};          // direct reading CH1, infrared only
   sensor::Sensor *full_spectrum_counts_sensor_{nullptr};     // direct reading CH0, infrared + visible light
   sensor::Sensor *ambient_light_sensor_{nullptr};            // calculated lux
   sensor::Sensor *actual_gain_sensor_{nullptr};              // actual gain of reading
   sensor::Sensor *actual_integration_time_sensor_{nullptr};  // actual integration time
-  sensor::Sensor *proximity_counts_sensor_{nullptr};         // proximity sensor
 
   bool is_any_als_sensor_enabled_() const {
     return this->ambient_light_sensor_ != nullptr || this->full_spectrum_counts_sensor_ != nullptr ||
            this->infrared_counts_sensor_ != nullptr || this->actual_gain_sensor_ != nullptr ||
            this->actual_integration_time_sensor_ != nullptr;
   }
+#endif
+#ifdef USE_LTR_PS
+  sensor::Sensor *proximity_counts_sensor_{nullptr};  // proximity sensor
+
   bool is_any_ps_sensor_enabled_() const { return this->proximity_counts_sensor_ != nullptr; }
+#endif
+  sensor::Sensor *suppressed_publishes_sensor_{nullptr};  // total number of publishes held back by deadbands
+
+  //
+  // ALS aggregation: chip is sampled continuously at repeat rate, every sample goes to the window,
+  // aggregates are published once per update interval. Lux is computed per sample with its own
+  // gain and integration time, so samples taken before and after re-ranging are comparable.
+  //
+#ifdef USE_LTR_ALS_AGGREGATION
+  sensor::Sensor *ambient_light_mean_sensor_{nullptr};
+  sensor::Sensor *ambient_light_min_sensor_{nullptr};
+  sensor::Sensor *ambient_light_max_sensor_{nullptr};
+  sensor::Sensor *ambient_light_percentile_sensor_{nullptr};  // over the whole window, within 3%
+  float als_percentile_{0.9f};
+
+  static constexpr float ALS_HISTOGRAM_UNIT = 0.01f;  // lux, up to ~670k lx
+  LogHistogram<4, 26> als_histogram_;
+  struct AlsStatistics {
+    float min{0.0f};
+    float max{0.0f};
+    float sum{0.0f};
+    uint32_t count{0};
+  } als_statistics_;
+  AlsReadings als_last_sample_;
+
+#endif
 
+  //
+  // Duty-cycled ALS - chip stays in standby between polls, it is woken up for a single
+  // sample with gain and integration time left from the previous one.
+  //
+#ifdef USE_LTR_ALS_STANDBY
+  bool als_standby_{false};
+  uint32_t als_awake_since_ms_{0};  // 0 while in standby
+  uint32_t als_active_time_ms_{0};  // total since the first wake up
+  uint32_t als_first_wake_ms_{0};
+  sensor::Sensor *als_active_time_sensor_{nullptr};  // estimated seconds per hour
+
+  void als_enter_standby_();
+#endif
+
+  //
+  // Raw sample trace for offline tuning of auto-ranging and lux calculation. Every hardware sample
+  // becomes a packed little endian record, logged in batches of up to TRACE_BATCH records as
+  // "trace: <hex>". update() flushes a partial batch.
+  //
+#ifdef USE_LTR_TRACE
+  struct TraceRecord {
+    uint32_t timestamp_ms;
+    uint16_t ch0;
+    uint16_t ch1;
+    uint16_t ps;  // raw, before LED drive scaling
+    uint8_t gain : 3;  // register values
+    uint8_t integration_time : 3;
+    bool als_valid : 1;
+    bool ps_valid : 1;
+  } __attribute__((packed));
+  static const uint8_t TRACE_BATCH = 8;
+  bool trace_{false};
+  TraceRecord trace_batch_[TRACE_BATCH];
+  uint8_t trace_count_{0};
+
+  TraceRecord &next_trace_record_();
+  void flush_trace_();  // logs the records collected so far, if any
+#endif
+
+  bool is_als_standby_() const {
+#ifdef USE_LTR_ALS_STANDBY
+    return this->als_standby_;
+#else
+    return false;
+#endif
+  }
+
+  //
+  // Adaptive sampling - update interval shrinks to the minimum when light changes and doubles
+  // (up to the maximum) while it is stable. Chip repeat rate follows, so it doesn't measure
+  // much more often than we read.
+  //
+#ifdef USE_LTR_ADAPTIVE_SAMPLING
+  struct AdaptiveSampling {
+    uint32_t min_interval_ms{0};
+    uint32_t max_interval_ms{0};
+    float change_threshold{0.0f};
+    float last_lux{NAN};
+    MeasurementRepeatRate base_repeat_rate{MeasurementRepeatRate::REPEAT_RATE_500MS};  // as configured
+    uint32_t rate_changed_ms{0};  // when the repeat rate was last changed
+    uint32_t rate_settle_ms{0};   // time after the change till the first sample at the new rate, 0 once waited
+  } adaptive_;
+#endif
+
+  bool is_adaptive_sampling_() const {
+#ifdef USE_LTR_ADAPTIVE_SAMPLING
+    return this->adaptive_.max_interval_ms > 0;
+#else
+    return false;
+#endif
+  }
+
+  bool is_als_aggregation_() const {
+#ifdef USE_LTR_ALS_AGGREGATION
+    return this->ambient_light_mean_sensor_ != nullptr || this->ambient_light_min_sensor_ != nullptr ||
+           this->ambient_light_max_sensor_ != nullptr || this->ambient_light_percentile_sensor_ != nullptr;
+#else
+    return false;
+#endif
+  }
+
+  //
+  // Deadbands, evaluated before publishing. Sensors without one publish every value.
+  //
+  struct Deadband {
+    sensor::Sensor *sensor;
+    float absolute;
+    float relative;
+    uint32_t max_silence_ms;
+    float last_value{NAN};
+    uint32_t last_published_ms{0};
+  };
+  std::vector<Deadband> deadbands_;
+  uint32_t suppressed_publishes_{0};
+
+  //
+  // PS streaming: every sample goes to the histogram (median) and min/max/mean, published once per update interval
+  //
+#ifdef USE_LTR_PS_STREAMING
+  sensor::Sensor *proximity_min_sensor_{nullptr};
+  sensor::Sensor *proximity_max_sensor_{nullptr};
+  sensor::Sensor *proximity_mean_sensor_{nullptr};
+  sensor::Sensor *proximity_median_sensor_{nullptr};  // over the whole window, within 3%
+  CallbackManager<void(uint16_t)> on_ps_sample_callback_;
+
+  LogHistogram<4, 11> ps_histogram_;  // 11 bit counts, exact below 16
+  struct PsStatistics {
+    uint16_t min{0xffff};
+    uint16_t max{0};
+    uint32_t sum{0};
+    uint32_t count{0};
+  } ps_statistics_;
+  HighFrequencyLoopRequester high_freq_;
+
+#endif
+
+  bool is_ps_streaming_() const {
+#ifdef USE_LTR_PS_STREAMING
+    return this->proximity_min_sensor_ != nullptr || this->proximity_max_sensor_ != nullptr ||
+           this->proximity_mean_sensor_ != nullptr || this->proximity_median_sensor_ != nullptr ||
+           this->on_ps_sample_callback_.size() > 0;
+#else
+    return false;
+#endif
+  }
+
+#ifdef USE_LTR_PS
   //
   // Trigger section for the automations
   //
@@ -165,8 +771,11 @@ class LTRAlsPsComponent : public PollingComponent, public i2c::I2CDevice {
   void add_on_ps_low_trigger_callback_(std::function<void()> callback) {
     this->on_ps_low_trigger_callback_.add(std::move(callback));
   }
+#endif
 };
 
+#ifdef USE_LTR_PS
+
 class LTRPsHighTrigger : public Trigger<> {
  public:
   explicit LTRPsHighTrigger(LTRAlsPsComponent *parent) {
@@ -180,5 +789,17 @@ class LTRPsLowTrigger : public Trigger<> {
     parent->add_on_ps_low_trigger_callback_([this]() { this->trigger(); });
   }
 };
+#endif
+
+#ifdef USE_LTR_PS_STREAMING
+
+class LTRPsSampleTrigger : public Trigger<uint16_t> {
+ public:
+  explicit LTRPsSampleTrigger(LTRAlsPsComponent *parent) {
+    parent->add_on_ps_sample_callback([this](uint16_t value) { this->trigger(value); });
+  }
+};
+#endif
+
 }  // namespace ltr_als_ps
 }  // namespace esphome
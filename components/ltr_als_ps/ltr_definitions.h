@@ -21,7 +21,7 @@ enum class CommandRegisters : uint8_t {
   ALS_PS_STATUS = 0x8C,     // ALS PS new data status
   PS_DATA_0 = 0x8D,         // PS measurement data, lower byte
   PS_DATA_1 = 0x8E,         // PS measurement data, upper byte
-  ALS_PS_INTERRUPT = 0x8F,  // Interrupt status
+  ALS_PS_INTERRUPT = 0x8F,  // Interrupt settings
   PS_THRES_UP_0 = 0x90,     // PS interrupt upper threshold, lower byte
   PS_THRES_UP_1 = 0x91,     // PS interrupt upper threshold, upper byte
   PS_THRES_LOW_0 = 0x92,    // PS interrupt lower threshold, lower byte
@@ -215,8 +215,8 @@ union MeasurementRateRegister {
 union PartIdRegister {
   uint8_t raw;
   struct {
-    uint8_t part_number_id : 4;
     uint8_t revision_id : 4;
+    uint8_t part_number_id : 4;
   } __attribute__((packed));
 };
 
@@ -248,13 +248,13 @@ union PsData1Register {
 };
 
 //
-// INTERRUPT Register (0x8F) (Read Only)
+// INTERRUPT Register (0x8F)
 //
 union InterruptRegister {
   uint8_t raw;
   struct {
-    bool ps_interrupt : 1;
-    bool als_interrupt : 1;
+    bool ps_interrupt : 1;        // 1 - INT pin is triggered by PS measurement
+    bool als_interrupt : 1;       // 1 - INT pin is triggered by ALS measurement
     bool interrupt_polarity : 1;  // 0 - active low (default), 1 - active high
     uint8_t reserved : 5;
   } __attribute__((packed));
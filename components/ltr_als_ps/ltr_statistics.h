@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace ltr_als_ps {
+
+//
+// Sample statistics for the streaming sensors.
+//
+
+// 0-based index of the nearest-rank p-th percentile among n sorted samples, p in 0..1
+inline size_t nearest_rank(float p, size_t n) {
+  auto rank = static_cast<size_t>(std::ceil(p * n));
+  return rank > 0 ? std::min(rank, n) - 1 : 0;
+}
+
+//
+// Percentile over a window of any length in fixed memory. Log-linear buckets: values below
+// 2^SUB_BITS have a bucket each, above that every octave is split into 2^SUB_BITS buckets, so a
+// result is within 1 / 2^(SUB_BITS + 1) of the exact nearest-rank value. Values are clamped to
+// MAX_BITS. When a bucket is about to overflow all of them are halved, proportions stay.
+//
+template<uint8_t SUB_BITS, uint8_t MAX_BITS> class LogHistogram {
+  static_assert(SUB_BITS < MAX_BITS && MAX_BITS <= 31, "Invalid histogram geometry");
+
+ public:
+  static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BITS;
+  static constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+  static constexpr uint32_t MAX_VALUE = (1u << MAX_BITS) - 1;
+
+  void push(uint32_t value) {
+    value = std::min(value, MAX_VALUE);
+    if (this->total_ == 0) {
+      this->min_ = this->max_ = value;
+    } else {
+      this->min_ = std::min(this->min_, value);
+      this->max_ = std::max(this->max_, value);
+    }
+    uint16_t &bucket = this->counts_[bucket_of(value)];
+    if (bucket == UINT16_MAX)
+      this->halve_();
+    bucket++;
+    this->total_++;
+  }
+
+  void clear() {
+    this->counts_.fill(0);
+    this->total_ = 0;
+  }
+
+  uint32_t size() const { return this->total_; }
+  bool empty() const { return this->total_ == 0; }
+
+  // Nearest-rank percentile, p in 0..1. Middle of the bucket, kept within the window min..max
+  uint32_t percentile(float p) const {
+    if (this->total_ == 0)
+      return 0;
+    size_t rank = nearest_rank(p, this->total_);
+    uint32_t seen = 0;
+    size_t i = 0;
+    for (; i < BUCKETS - 1; i++) {
+      seen += this->counts_[i];
+      if (seen > rank)
+        break;
+    }
+    return std::max(this->min_, std::min(this->max_, value_of(i)));
+  }
+
+  static size_t bucket_of(uint32_t value) {
+    if (value < SUB_BUCKETS)
+      return value;
+    uint8_t shift = 31 - __builtin_clz(value) - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + (value >> shift) - SUB_BUCKETS;
+  }
+
+  static uint32_t value_of(size_t bucket) {
+    if (bucket < SUB_BUCKETS)
+      return bucket;
+    uint8_t shift = bucket / SUB_BUCKETS - 1;
+    uint32_t lower = (bucket % SUB_BUCKETS + SUB_BUCKETS) << shift;
+    return lower + ((1u << shift) - 1) / 2;
+  }
+
+ protected:
+  void halve_() {
+    this->total_ = 0;
+    for (auto &count : this->counts_) {
+      count = (count + 1) / 2;
+      this->total_ += count;
+    }
+  }
+
+  std::array<uint16_t, BUCKETS> counts_{};
+  uint32_t total_{0};
+  uint32_t min_{0};
+  uint32_t max_{0};
+};
+
+}  // namespace ltr_als_ps
+}  // namespace esphome
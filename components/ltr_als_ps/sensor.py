@@ -1,26 +1,34 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome import automation
+from esphome import automation, pins
+from esphome.core import CORE
 from esphome.components import i2c, sensor
 from esphome.const import (
     CONF_ACTUAL_GAIN,
     CONF_AUTO_MODE,
     CONF_GAIN,
     CONF_GLASS_ATTENUATION_FACTOR,
+    CONF_I2C_ID,
     CONF_ID,
     CONF_INTEGRATION_TIME,
+    CONF_INTERRUPT_PIN,
     CONF_NAME,
     CONF_REPEAT,
     CONF_TRIGGER_ID,
     CONF_TYPE,
     UNIT_LUX,
+    UNIT_MICROSECOND,
     UNIT_MILLISECOND,
+    UNIT_SECOND,
     ICON_BRIGHTNESS_5,
     ICON_BRIGHTNESS_6,
+    ICON_COUNTER,
     ICON_TIMER,
     DEVICE_CLASS_ILLUMINANCE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     DEVICE_CLASS_DISTANCE,
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
 )
 
 CODEOWNERS = ["@latonita"]
@@ -36,11 +44,58 @@ CONF_ACTUAL_INTEGRATION_TIME = "actual_integration_time"
 CONF_AMBIENT_LIGHT = "ambient_light"
 CONF_FULL_SPECTRUM_COUNTS = "full_spectrum_counts"
 CONF_INFRARED_COUNTS = "infrared_counts"
+CONF_SETTLE_TIME = "settle_time"
+CONF_I2C_TRANSACTIONS = "i2c_transactions"
+CONF_I2C_ERRORS = "i2c_errors"
+CONF_MAX_LOOP_TIME = "max_loop_time"
+CONF_DATA_TIMEOUTS = "data_timeouts"
+CONF_BAD_DATA = "bad_data"
+CONF_STALE_DATA = "stale_data"
+CONF_AUTO_RANGE_ADJUSTMENTS = "auto_range_adjustments"
+CONF_FLOAT_LUX_REFERENCE = "float_lux_reference"
+CONF_SUPPRESSED_PUBLISHES = "suppressed_publishes"
+CONF_DEADBAND = "deadband"
+CONF_ABSOLUTE = "absolute"
+CONF_RELATIVE = "relative"
+CONF_MAX_SILENCE = "max_silence"
+CONF_AMBIENT_LIGHT_MEAN = "ambient_light_mean"
+CONF_AMBIENT_LIGHT_MIN = "ambient_light_min"
+CONF_AMBIENT_LIGHT_MAX = "ambient_light_max"
+CONF_AMBIENT_LIGHT_PERCENTILE = "ambient_light_percentile"
+CONF_PERCENTILE = "percentile"
+CONF_ALS_REPORT_ON_CHANGE = "als_report_on_change"
+CONF_ALS_INTERRUPT_PERSISTENCE = "als_interrupt_persistence"
+CONF_PERCENT = "percent"
+CONF_ADAPTIVE_SAMPLING = "adaptive_sampling"
+CONF_ALS_STANDBY = "als_standby"
+CONF_PS_CALIBRATION = "ps_calibration"
+CONF_PS_LED_CURRENT = "ps_led_current"
+CONF_PS_LED_DUTY = "ps_led_duty"
+CONF_PS_LED_FREQUENCY = "ps_led_frequency"
+CONF_PS_PULSES = "ps_pulses"
+CONF_PS_LED_CONTROL = "ps_led_control"
+CONF_PS_LED_CHARGE = "ps_led_charge"
+UNIT_MICROCOULOMB = "µC"
+CONF_MARGIN = "margin"
+CONF_TRACKING_INTERVAL = "tracking_interval"
+CONF_ALS_ACTIVE_TIME = "als_active_time"
+CONF_TRACE = "trace"
+CONF_MIN_INTERVAL = "min_interval"
+CONF_MAX_INTERVAL = "max_interval"
+CONF_CHANGE_THRESHOLD = "change_threshold"
+CONF_LUX = "lux"
 
 CONF_PS_COOLDOWN = "ps_cooldown"
 CONF_PS_COUNTS = "ps_counts"
 CONF_PS_GAIN = "ps_gain"
 CONF_PS_HIGH_THRESHOLD = "ps_high_threshold"
+CONF_PS_MEASUREMENT_RATE = "ps_measurement_rate"
+CONF_PS_COUNTS_MIN = "ps_counts_min"
+CONF_PS_COUNTS_MAX = "ps_counts_max"
+CONF_PS_COUNTS_MEAN = "ps_counts_mean"
+CONF_PS_COUNTS_MEDIAN = "ps_counts_median"
+CONF_ON_PS_SAMPLE = "on_ps_sample"
+CONF_PS_INTERRUPT_PERSISTENCE = "ps_interrupt_persistence"
 CONF_PS_LOW_THRESHOLD = "ps_low_threshold"
 CONF_ON_PS_HIGH_THRESHOLD = "on_ps_high_threshold"
 CONF_ON_PS_LOW_THRESHOLD = "on_ps_low_threshold"
@@ -97,10 +152,107 @@ PS_GAINS = {
     "64X": PsGain.PS_GAIN_64,
 }
 
+PsMeasurementRate = ltr_als_ps_ns.enum("PsMeasurementRate")
+PS_MEASUREMENT_RATES = {
+    10: PsMeasurementRate.PS_MEAS_RATE_10MS,
+    50: PsMeasurementRate.PS_MEAS_RATE_50MS,
+    70: PsMeasurementRate.PS_MEAS_RATE_70MS,
+    100: PsMeasurementRate.PS_MEAS_RATE_100MS,
+    200: PsMeasurementRate.PS_MEAS_RATE_200MS,
+    500: PsMeasurementRate.PS_MEAS_RATE_500MS,
+    1000: PsMeasurementRate.PS_MEAS_RATE_1000MS,
+    2000: PsMeasurementRate.PS_MEAS_RATE_2000MS,
+}
+
+PsLedCurrent = ltr_als_ps_ns.enum("PsLedCurrent")
+PS_LED_CURRENTS = {
+    5: PsLedCurrent.PS_LED_CURRENT_5MA,
+    10: PsLedCurrent.PS_LED_CURRENT_10MA,
+    20: PsLedCurrent.PS_LED_CURRENT_20MA,
+    50: PsLedCurrent.PS_LED_CURRENT_50MA,
+    100: PsLedCurrent.PS_LED_CURRENT_100MA,
+}
+
+PsLedDuty = ltr_als_ps_ns.enum("PsLedDuty")
+PS_LED_DUTIES = {
+    25: PsLedDuty.PS_LED_DUTY_25,
+    50: PsLedDuty.PS_LED_DUTY_50,
+    75: PsLedDuty.PS_LED_DUTY_75,
+    100: PsLedDuty.PS_LED_DUTY_100,
+}
+
+PsLedFreq = ltr_als_ps_ns.enum("PsLedFreq")
+PS_LED_FREQUENCIES = {
+    30: PsLedFreq.PS_LED_FREQ_30KHZ,
+    40: PsLedFreq.PS_LED_FREQ_40KHZ,
+    50: PsLedFreq.PS_LED_FREQ_50KHZ,
+    60: PsLedFreq.PS_LED_FREQ_60KHZ,
+    70: PsLedFreq.PS_LED_FREQ_70KHZ,
+    80: PsLedFreq.PS_LED_FREQ_80KHZ,
+    90: PsLedFreq.PS_LED_FREQ_90KHZ,
+    100: PsLedFreq.PS_LED_FREQ_100KHZ,
+}
+
 LTRPsHighTrigger = ltr_als_ps_ns.class_(
     "LTRPsHighTrigger", automation.Trigger.template()
 )
 LTRPsLowTrigger = ltr_als_ps_ns.class_("LTRPsLowTrigger", automation.Trigger.template())
+LTRPsSampleTrigger = ltr_als_ps_ns.class_(
+    "LTRPsSampleTrigger", automation.Trigger.template(cg.uint16)
+)
+
+
+DEADBAND_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_DEADBAND): cv.Schema(
+            {
+                cv.Optional(CONF_ABSOLUTE, default=0.0): cv.positive_float,
+                cv.Optional(CONF_RELATIVE, default="0%"): cv.percentage,
+                cv.Optional(
+                    CONF_MAX_SILENCE, default="0s"
+                ): cv.positive_time_period_milliseconds,
+            }
+        ),
+    }
+)
+
+
+def ltr_sensor_schema(**kwargs):
+    return sensor.sensor_schema(**kwargs).extend(DEADBAND_SCHEMA)
+
+
+def diagnostic_rate_schema():
+    # published once a minute, value is the count within that minute
+    return ltr_sensor_schema(
+        unit_of_measurement="/min",
+        icon=ICON_COUNTER,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+
+def diagnostic_total_schema():
+    return ltr_sensor_schema(
+        icon=ICON_COUNTER,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+
+async def new_ltr_sensor(var, config):
+    sens = await sensor.new_sensor(config)
+    if deadband_config := config.get(CONF_DEADBAND):
+        cg.add(
+            var.set_sensor_deadband(
+                sens,
+                deadband_config[CONF_ABSOLUTE],
+                deadband_config[CONF_RELATIVE],
+                deadband_config[CONF_MAX_SILENCE],
+            )
+        )
+    return sens
 
 
 def validate_integration_time(value):
@@ -113,6 +265,36 @@ def validate_repeat_rate(value):
     return cv.enum(MEASUREMENT_REPEAT_RATES, int=True)(value)
 
 
+def validate_ps_measurement_rate(value):
+    value = cv.positive_time_period_milliseconds(value).total_milliseconds
+    return cv.enum(PS_MEASUREMENT_RATES, int=True)(value)
+
+
+def validate_ps_led_current(value):
+    value = cv.current(value) * 1000
+    return cv.enum(PS_LED_CURRENTS, int=True)(int(round(value)))
+
+
+def validate_ps_led_duty(value):
+    value = cv.percentage(value) * 100
+    return cv.enum(PS_LED_DUTIES, int=True)(int(round(value)))
+
+
+def validate_ps_led_frequency(value):
+    value = cv.frequency(value) / 1000
+    return cv.enum(PS_LED_FREQUENCIES, int=True)(int(round(value)))
+
+
+def validate_ps_led_control(config):
+    if not config.get(CONF_PS_LED_CONTROL):
+        return config
+    # readings are scaled in software, chip would compare raw counts against thresholds and offset
+    for key in (CONF_INTERRUPT_PIN, CONF_PS_CALIBRATION):
+        if key in config:
+            raise cv.Invalid(f"{CONF_PS_LED_CONTROL} can't be used together with {key}")
+    return config
+
+
 def validate_time_and_repeat_rate(config):
     integraton_time = config[CONF_INTEGRATION_TIME]
     repeat_rate = config[CONF_REPEAT]
@@ -123,11 +305,146 @@ def validate_time_and_repeat_rate(config):
     return config
 
 
+def validate_als_aggregation(config):
+    aggregated = any(key in config for key in ALS_AGGREGATION_KEYS)
+    if aggregated and CONF_ALS_REPORT_ON_CHANGE in config:
+        raise cv.Invalid(
+            f"{CONF_ALS_REPORT_ON_CHANGE} can't be used together with aggregated ambient light sensors"
+        )
+    return config
+
+
+def validate_als_standby(config):
+    if not config.get(CONF_ALS_STANDBY):
+        if CONF_ALS_ACTIVE_TIME in config:
+            raise cv.Invalid(f"{CONF_ALS_ACTIVE_TIME} requires {CONF_ALS_STANDBY}")
+        return config
+    # these need the chip measuring all the time
+    for key in ALS_AGGREGATION_KEYS + (CONF_ALS_REPORT_ON_CHANGE,):
+        if key in config:
+            raise cv.Invalid(f"{CONF_ALS_STANDBY} can't be used together with {key}")
+    return config
+
+
+def validate_adaptive_sampling(config):
+    if CONF_ADAPTIVE_SAMPLING not in config:
+        return config
+    for key in ALS_AGGREGATION_KEYS + (CONF_ALS_REPORT_ON_CHANGE,):
+        if key in config:
+            raise cv.Invalid(f"{CONF_ADAPTIVE_SAMPLING} can't be used together with {key}")
+    adaptive = config[CONF_ADAPTIVE_SAMPLING]
+    if adaptive[CONF_MIN_INTERVAL] >= adaptive[CONF_MAX_INTERVAL]:
+        raise cv.Invalid(
+            f"{CONF_MIN_INTERVAL} shall be less than {CONF_MAX_INTERVAL}",
+            path=[CONF_ADAPTIVE_SAMPLING],
+        )
+    return config
+
+
+ALS_AGGREGATION_KEYS = (
+    CONF_AMBIENT_LIGHT_MEAN,
+    CONF_AMBIENT_LIGHT_MIN,
+    CONF_AMBIENT_LIGHT_MAX,
+    CONF_AMBIENT_LIGHT_PERCENTILE,
+)
+ALS_DIAGNOSTIC_KEYS = (
+    CONF_SETTLE_TIME,
+    CONF_DATA_TIMEOUTS,
+    CONF_BAD_DATA,
+    CONF_STALE_DATA,
+    CONF_AUTO_RANGE_ADJUSTMENTS,
+)
+DIAGNOSTIC_KEYS = (
+    CONF_I2C_TRANSACTIONS,
+    CONF_I2C_ERRORS,
+    CONF_MAX_LOOP_TIME,
+) + ALS_DIAGNOSTIC_KEYS
+ALS_KEYS = (
+    (
+        CONF_AMBIENT_LIGHT,
+        CONF_INFRARED_COUNTS,
+        CONF_FULL_SPECTRUM_COUNTS,
+        CONF_ACTUAL_GAIN,
+        CONF_ACTUAL_INTEGRATION_TIME,
+        CONF_ALS_REPORT_ON_CHANGE,
+        CONF_ADAPTIVE_SAMPLING,
+        CONF_ALS_STANDBY,
+        CONF_ALS_ACTIVE_TIME,
+    )
+    + ALS_AGGREGATION_KEYS
+    + ALS_DIAGNOSTIC_KEYS
+)
+PS_STREAMING_KEYS = (
+    CONF_PS_COUNTS_MIN,
+    CONF_PS_COUNTS_MAX,
+    CONF_PS_COUNTS_MEAN,
+    CONF_PS_COUNTS_MEDIAN,
+    CONF_ON_PS_SAMPLE,
+)
+PS_KEYS = (
+    CONF_PS_COUNTS,
+    CONF_PS_CALIBRATION,
+    CONF_PS_LED_CONTROL,
+    CONF_PS_LED_CHARGE,
+    CONF_ON_PS_HIGH_THRESHOLD,
+    CONF_ON_PS_LOW_THRESHOLD,
+) + PS_STREAMING_KEYS
+
+
+def has_als(config):
+    return config[CONF_TYPE] in ("ALS", "ALS_PS")
+
+
+def has_ps(config):
+    return config[CONF_TYPE] in ("PS", "ALS_PS")
+
+
+def root_i2c_bus_id(bus_id):
+    """Follows TCA9548A channels up to the physical bus the sensor really shares"""
+    seen = set()
+    while bus_id.id not in seen:
+        seen.add(bus_id.id)
+        parent = None
+        for mux in CORE.config.get("tca9548a", []):
+            for channel in mux.get("channels", []):
+                if channel["bus_id"].id == bus_id.id:
+                    parent = mux[CONF_I2C_ID]
+        if parent is None:
+            break
+        bus_id = parent
+    return bus_id
+
+
+def validate_type_features(config):
+    # Code for the parts not used by the sensor type is not compiled in at all
+    if not has_als(config):
+        for key in ALS_KEYS:
+            if key in config:
+                raise cv.Invalid(f"{key} requires type ALS or ALS_PS")
+    if not has_ps(config):
+        for key in PS_KEYS:
+            if key in config:
+                raise cv.Invalid(f"{key} requires type PS or ALS_PS")
+    return config
+
+
+def als_lux_schema():
+    return ltr_sensor_schema(
+        unit_of_measurement=UNIT_LUX,
+        icon=ICON_BRIGHTNESS_6,
+        accuracy_decimals=1,
+        device_class=DEVICE_CLASS_ILLUMINANCE,
+        state_class=STATE_CLASS_MEASUREMENT,
+    )
+
+
 CONFIG_SCHEMA = cv.All(
     cv.Schema(
         {
             cv.GenerateID(): cv.declare_id(LTRAlsPsComponent),
             cv.Optional(CONF_TYPE, default="ALS_PS"): cv.enum(LTR_TYPES, upper=True),
+            cv.Optional(CONF_INTERRUPT_PIN): pins.internal_gpio_input_pin_schema,
+            cv.Optional(CONF_TRACE): cv.boolean,
             cv.Optional(CONF_AUTO_MODE, default=True): cv.boolean,
             cv.Optional(CONF_GAIN, default="1X"): cv.enum(ALS_GAINS, upper=True),
             cv.Optional(
@@ -135,18 +452,93 @@ CONFIG_SCHEMA = cv.All(
             ): validate_integration_time,
             cv.Optional(CONF_REPEAT, default="500ms"): validate_repeat_rate,
             cv.Optional(CONF_GLASS_ATTENUATION_FACTOR, default=1.0): cv.float_range(
-                min=1.0
+                min=1.0, max=100.0
+            ),
+            cv.Optional(CONF_FLOAT_LUX_REFERENCE, default=False): cv.boolean,
+            cv.Optional(CONF_ALS_REPORT_ON_CHANGE): cv.All(
+                cv.Schema(
+                    {
+                        # 0 would make every sample a change
+                        cv.Optional(CONF_PERCENT): cv.All(
+                            cv.percentage, cv.Range(min=0.0, min_included=False)
+                        ),
+                        cv.Optional(CONF_LUX): cv.positive_not_null_float,
+                    }
+                ),
+                cv.has_exactly_one_key(CONF_PERCENT, CONF_LUX),
+            ),
+            cv.Optional(CONF_ALS_STANDBY): cv.boolean,
+            cv.Optional(CONF_ALS_ACTIVE_TIME): cv.maybe_simple_value(
+                ltr_sensor_schema(
+                    unit_of_measurement=UNIT_SECOND,
+                    icon=ICON_TIMER,
+                    accuracy_decimals=1,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_ADAPTIVE_SAMPLING): cv.Schema(
+                {
+                    cv.Optional(
+                        CONF_MIN_INTERVAL, default="5s"
+                    ): cv.positive_time_period_milliseconds,
+                    cv.Optional(
+                        CONF_MAX_INTERVAL, default="5min"
+                    ): cv.positive_time_period_milliseconds,
+                    cv.Optional(CONF_CHANGE_THRESHOLD, default="10%"): cv.All(
+                        cv.percentage, cv.Range(min=0.01)
+                    ),
+                }
+            ),
+            cv.Optional(CONF_ALS_INTERRUPT_PERSISTENCE, default=0): cv.int_range(
+                min=0, max=15
             ),
             cv.Optional(
                 CONF_PS_COOLDOWN, default="5s"
             ): cv.positive_time_period_seconds,
             cv.Optional(CONF_PS_GAIN, default="16X"): cv.enum(PS_GAINS, upper=True),
+            cv.Optional(
+                CONF_PS_MEASUREMENT_RATE, default="50ms"
+            ): validate_ps_measurement_rate,
+            cv.Optional(
+                CONF_PS_LED_CURRENT, default="100mA"
+            ): validate_ps_led_current,
+            cv.Optional(CONF_PS_LED_DUTY, default="100%"): validate_ps_led_duty,
+            cv.Optional(
+                CONF_PS_LED_FREQUENCY, default="60kHz"
+            ): validate_ps_led_frequency,
+            cv.Optional(CONF_PS_PULSES, default=1): cv.int_range(min=1, max=15),
+            cv.Optional(CONF_PS_LED_CONTROL): cv.boolean,
+            cv.Optional(CONF_PS_LED_CHARGE): cv.maybe_simple_value(
+                ltr_sensor_schema(
+                    unit_of_measurement=UNIT_MICROCOULOMB,
+                    icon=ICON_PROXIMITY,
+                    accuracy_decimals=3,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_PS_CALIBRATION): cv.Schema(
+                {
+                    cv.Optional(CONF_MARGIN, default=10): cv.int_range(
+                        min=0, max=200
+                    ),
+                    cv.Optional(
+                        CONF_TRACKING_INTERVAL, default="10min"
+                    ): cv.positive_time_period_milliseconds,
+                }
+            ),
             cv.Optional(CONF_PS_HIGH_THRESHOLD, default=65535): cv.int_range(
                 min=0, max=65535
             ),
             cv.Optional(CONF_PS_LOW_THRESHOLD, default=0): cv.int_range(
                 min=0, max=65535
             ),
+            cv.Optional(CONF_PS_INTERRUPT_PERSISTENCE, default=0): cv.int_range(
+                min=0, max=15
+            ),
             cv.Optional(CONF_ON_PS_HIGH_THRESHOLD): automation.validate_automation(
                 {
                     cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(LTRPsHighTrigger),
@@ -157,8 +549,13 @@ CONFIG_SCHEMA = cv.All(
                     cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(LTRPsLowTrigger),
                 }
             ),
+            cv.Optional(CONF_ON_PS_SAMPLE): automation.validate_automation(
+                {
+                    cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(LTRPsSampleTrigger),
+                }
+            ),
             cv.Optional(CONF_AMBIENT_LIGHT): cv.maybe_simple_value(
-                sensor.sensor_schema(
+                ltr_sensor_schema(
                     unit_of_measurement=UNIT_LUX,
                     icon=ICON_BRIGHTNESS_6,
                     accuracy_decimals=1,
@@ -167,8 +564,34 @@ CONFIG_SCHEMA = cv.All(
                 ),
                 key=CONF_NAME,
             ),
-            cv.Optional(CONF_INFRARED_COUNTS): cv.maybe_simple_value(
+            cv.Optional(CONF_AMBIENT_LIGHT_MEAN): cv.maybe_simple_value(
+                als_lux_schema(), key=CONF_NAME
+            ),
+            cv.Optional(CONF_AMBIENT_LIGHT_MIN): cv.maybe_simple_value(
+                als_lux_schema(), key=CONF_NAME
+            ),
+            cv.Optional(CONF_AMBIENT_LIGHT_MAX): cv.maybe_simple_value(
+                als_lux_schema(), key=CONF_NAME
+            ),
+            cv.Optional(CONF_AMBIENT_LIGHT_PERCENTILE): cv.maybe_simple_value(
+                als_lux_schema().extend(
+                    {
+                        cv.Optional(CONF_PERCENTILE, default="90%"): cv.percentage,
+                    }
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_SUPPRESSED_PUBLISHES): cv.maybe_simple_value(
                 sensor.sensor_schema(
+                    icon=ICON_COUNTER,
+                    accuracy_decimals=0,
+                    state_class=STATE_CLASS_TOTAL_INCREASING,
+                    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_INFRARED_COUNTS): cv.maybe_simple_value(
+                ltr_sensor_schema(
                     unit_of_measurement=UNIT_COUNTS,
                     icon=ICON_BRIGHTNESS_5,
                     accuracy_decimals=0,
@@ -178,7 +601,7 @@ CONFIG_SCHEMA = cv.All(
                 key=CONF_NAME,
             ),
             cv.Optional(CONF_FULL_SPECTRUM_COUNTS): cv.maybe_simple_value(
-                sensor.sensor_schema(
+                ltr_sensor_schema(
                     unit_of_measurement=UNIT_COUNTS,
                     icon=ICON_BRIGHTNESS_7,
                     accuracy_decimals=0,
@@ -188,7 +611,47 @@ CONFIG_SCHEMA = cv.All(
                 key=CONF_NAME,
             ),
             cv.Optional(CONF_PS_COUNTS): cv.maybe_simple_value(
-                sensor.sensor_schema(
+                ltr_sensor_schema(
+                    unit_of_measurement=UNIT_COUNTS,
+                    icon=ICON_PROXIMITY,
+                    accuracy_decimals=0,
+                    device_class=DEVICE_CLASS_DISTANCE,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_PS_COUNTS_MIN): cv.maybe_simple_value(
+                ltr_sensor_schema(
+                    unit_of_measurement=UNIT_COUNTS,
+                    icon=ICON_PROXIMITY,
+                    accuracy_decimals=0,
+                    device_class=DEVICE_CLASS_DISTANCE,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_PS_COUNTS_MAX): cv.maybe_simple_value(
+                ltr_sensor_schema(
+                    unit_of_measurement=UNIT_COUNTS,
+                    icon=ICON_PROXIMITY,
+                    accuracy_decimals=0,
+                    device_class=DEVICE_CLASS_DISTANCE,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_PS_COUNTS_MEAN): cv.maybe_simple_value(
+                ltr_sensor_schema(
+                    unit_of_measurement=UNIT_COUNTS,
+                    icon=ICON_PROXIMITY,
+                    accuracy_decimals=1,
+                    device_class=DEVICE_CLASS_DISTANCE,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_PS_COUNTS_MEDIAN): cv.maybe_simple_value(
+                ltr_sensor_schema(
                     unit_of_measurement=UNIT_COUNTS,
                     icon=ICON_PROXIMITY,
                     accuracy_decimals=0,
@@ -198,7 +661,7 @@ CONFIG_SCHEMA = cv.All(
                 key=CONF_NAME,
             ),
             cv.Optional(CONF_ACTUAL_GAIN): cv.maybe_simple_value(
-                sensor.sensor_schema(
+                ltr_sensor_schema(
                     icon=ICON_GAIN,
                     accuracy_decimals=0,
                     device_class=DEVICE_CLASS_ILLUMINANCE,
@@ -207,11 +670,55 @@ CONFIG_SCHEMA = cv.All(
                 key=CONF_NAME,
             ),
             cv.Optional(CONF_ACTUAL_INTEGRATION_TIME): cv.maybe_simple_value(
-                sensor.sensor_schema(
+                ltr_sensor_schema(
+                    unit_of_measurement=UNIT_MILLISECOND,
+                    icon=ICON_TIMER,
+                    accuracy_decimals=0,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_SETTLE_TIME): cv.maybe_simple_value(
+                ltr_sensor_schema(
                     unit_of_measurement=UNIT_MILLISECOND,
                     icon=ICON_TIMER,
                     accuracy_decimals=0,
                     state_class=STATE_CLASS_MEASUREMENT,
+                    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_I2C_TRANSACTIONS): cv.maybe_simple_value(
+                diagnostic_rate_schema(), key=CONF_NAME
+            ),
+            cv.Optional(CONF_I2C_ERRORS): cv.maybe_simple_value(
+                diagnostic_rate_schema(), key=CONF_NAME
+            ),
+            cv.Optional(CONF_MAX_LOOP_TIME): cv.maybe_simple_value(
+                ltr_sensor_schema(
+                    unit_of_measurement=UNIT_MICROSECOND,
+                    icon=ICON_TIMER,
+                    accuracy_decimals=0,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                ),
+                key=CONF_NAME,
+            ),
+            cv.Optional(CONF_DATA_TIMEOUTS): cv.maybe_simple_value(
+                diagnostic_total_schema(), key=CONF_NAME
+            ),
+            cv.Optional(CONF_BAD_DATA): cv.maybe_simple_value(
+                diagnostic_total_schema(), key=CONF_NAME
+            ),
+            cv.Optional(CONF_STALE_DATA): cv.maybe_simple_value(
+                diagnostic_total_schema(), key=CONF_NAME
+            ),
+            cv.Optional(CONF_AUTO_RANGE_ADJUSTMENTS): cv.maybe_simple_value(
+                ltr_sensor_schema(
+                    icon=ICON_GAIN,
+                    accuracy_decimals=2,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
                 ),
                 key=CONF_NAME,
             ),
@@ -220,6 +727,11 @@ CONFIG_SCHEMA = cv.All(
     .extend(cv.polling_component_schema("60s"))
     .extend(i2c.i2c_device_schema(0x29)),
     validate_time_and_repeat_rate,
+    validate_als_aggregation,
+    validate_als_standby,
+    validate_adaptive_sampling,
+    validate_ps_led_control,
+    validate_type_features,
 )
 
 
@@ -228,30 +740,106 @@ async def to_code(config):
     await cg.register_component(var, config)
     await i2c.register_i2c_device(var, config)
 
+    # Defines are global for the build - union of features used by all instances
+    if has_als(config):
+        cg.add_define("USE_LTR_ALS")
+    if has_ps(config):
+        cg.add_define("USE_LTR_PS")
+    if any(key in config for key in ALS_AGGREGATION_KEYS):
+        cg.add_define("USE_LTR_ALS_AGGREGATION")
+    if any(key in config for key in PS_STREAMING_KEYS):
+        cg.add_define("USE_LTR_PS_STREAMING")
+    if any(key in config for key in DIAGNOSTIC_KEYS):
+        cg.add_define("USE_LTR_DIAGNOSTICS")
+    if CONF_ADAPTIVE_SAMPLING in config:
+        cg.add_define("USE_LTR_ADAPTIVE_SAMPLING")
+    if config.get(CONF_ALS_STANDBY):
+        cg.add_define("USE_LTR_ALS_STANDBY")
+    if CONF_PS_CALIBRATION in config:
+        cg.add_define("USE_LTR_PS_CALIBRATION")
+    if config.get(CONF_PS_LED_CONTROL) or CONF_PS_LED_CHARGE in config:
+        cg.add_define("USE_LTR_PS_LED_CONTROL")
+    if config.get(CONF_TRACE):
+        cg.add_define("USE_LTR_TRACE")
+
     if als_config := config.get(CONF_AMBIENT_LIGHT):
-        sens = await sensor.new_sensor(als_config)
+        sens = await new_ltr_sensor(var, als_config)
         cg.add(var.set_ambient_light_sensor(sens))
 
+    if als_mean_config := config.get(CONF_AMBIENT_LIGHT_MEAN):
+        sens = await new_ltr_sensor(var, als_mean_config)
+        cg.add(var.set_ambient_light_mean_sensor(sens))
+
+    if als_min_config := config.get(CONF_AMBIENT_LIGHT_MIN):
+        sens = await new_ltr_sensor(var, als_min_config)
+        cg.add(var.set_ambient_light_min_sensor(sens))
+
+    if als_max_config := config.get(CONF_AMBIENT_LIGHT_MAX):
+        sens = await new_ltr_sensor(var, als_max_config)
+        cg.add(var.set_ambient_light_max_sensor(sens))
+
+    if als_pct_config := config.get(CONF_AMBIENT_LIGHT_PERCENTILE):
+        sens = await new_ltr_sensor(var, als_pct_config)
+        cg.add(var.set_ambient_light_percentile_sensor(sens))
+        cg.add(var.set_als_percentile(als_pct_config[CONF_PERCENTILE]))
+
     if infrared_cnt_config := config.get(CONF_INFRARED_COUNTS):
-        sens = await sensor.new_sensor(infrared_cnt_config)
+        sens = await new_ltr_sensor(var, infrared_cnt_config)
         cg.add(var.set_infrared_counts_sensor(sens))
 
     if full_spect_cnt_config := config.get(CONF_FULL_SPECTRUM_COUNTS):
-        sens = await sensor.new_sensor(full_spect_cnt_config)
+        sens = await new_ltr_sensor(var, full_spect_cnt_config)
         cg.add(var.set_full_spectrum_counts_sensor(sens))
 
     if act_gain_config := config.get(CONF_ACTUAL_GAIN):
-        sens = await sensor.new_sensor(act_gain_config)
+        sens = await new_ltr_sensor(var, act_gain_config)
         cg.add(var.set_actual_gain_sensor(sens))
 
     if act_itime_config := config.get(CONF_ACTUAL_INTEGRATION_TIME):
-        sens = await sensor.new_sensor(act_itime_config)
+        sens = await new_ltr_sensor(var, act_itime_config)
         cg.add(var.set_actual_integration_time_sensor(sens))
 
+    if settle_time_config := config.get(CONF_SETTLE_TIME):
+        sens = await new_ltr_sensor(var, settle_time_config)
+        cg.add(var.set_settle_time_sensor(sens))
+
+    for key, setter in (
+        (CONF_I2C_TRANSACTIONS, var.set_i2c_transactions_sensor),
+        (CONF_I2C_ERRORS, var.set_i2c_errors_sensor),
+        (CONF_MAX_LOOP_TIME, var.set_max_loop_time_sensor),
+        (CONF_DATA_TIMEOUTS, var.set_data_timeouts_sensor),
+        (CONF_BAD_DATA, var.set_bad_data_sensor),
+        (CONF_STALE_DATA, var.set_stale_data_sensor),
+        (CONF_AUTO_RANGE_ADJUSTMENTS, var.set_auto_range_adjustments_sensor),
+    ):
+        if diag_config := config.get(key):
+            sens = await new_ltr_sensor(var, diag_config)
+            cg.add(setter(sens))
+
+    if suppressed_config := config.get(CONF_SUPPRESSED_PUBLISHES):
+        sens = await sensor.new_sensor(suppressed_config)
+        cg.add(var.set_suppressed_publishes_sensor(sens))
+
     if prox_cnt_config := config.get(CONF_PS_COUNTS):
-        sens = await sensor.new_sensor(prox_cnt_config)
+        sens = await new_ltr_sensor(var, prox_cnt_config)
         cg.add(var.set_proximity_counts_sensor(sens))
 
+    if prox_min_config := config.get(CONF_PS_COUNTS_MIN):
+        sens = await new_ltr_sensor(var, prox_min_config)
+        cg.add(var.set_proximity_min_sensor(sens))
+
+    if prox_max_config := config.get(CONF_PS_COUNTS_MAX):
+        sens = await new_ltr_sensor(var, prox_max_config)
+        cg.add(var.set_proximity_max_sensor(sens))
+
+    if prox_mean_config := config.get(CONF_PS_COUNTS_MEAN):
+        sens = await new_ltr_sensor(var, prox_mean_config)
+        cg.add(var.set_proximity_mean_sensor(sens))
+
+    if prox_median_config := config.get(CONF_PS_COUNTS_MEDIAN):
+        sens = await new_ltr_sensor(var, prox_median_config)
+        cg.add(var.set_proximity_median_sensor(sens))
+
     for prox_high_tr in config.get(CONF_ON_PS_HIGH_THRESHOLD, []):
         trigger = cg.new_Pvariable(prox_high_tr[CONF_TRIGGER_ID], var)
         await automation.build_automation(trigger, [], prox_high_tr)
@@ -260,15 +848,85 @@ async def to_code(config):
         trigger = cg.new_Pvariable(prox_low_tr[CONF_TRIGGER_ID], var)
         await automation.build_automation(trigger, [], prox_low_tr)
 
-    cg.add(var.set_ltr_type(config[CONF_TYPE]))
+    for prox_sample_tr in config.get(CONF_ON_PS_SAMPLE, []):
+        trigger = cg.new_Pvariable(prox_sample_tr[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(cg.uint16, "x")], prox_sample_tr)
 
-    cg.add(var.set_als_auto_mode(config[CONF_AUTO_MODE]))
-    cg.add(var.set_als_gain(config[CONF_GAIN]))
-    cg.add(var.set_als_integration_time(config[CONF_INTEGRATION_TIME]))
-    cg.add(var.set_als_meas_repeat_rate(config[CONF_REPEAT]))
-    cg.add(var.set_als_glass_attenuation_factor(config[CONF_GLASS_ATTENUATION_FACTOR]))
+    cg.add(var.set_ltr_type(config[CONF_TYPE]))
+    cg.add(var.set_preference_id(config[CONF_ID].id))
+    if config.get(CONF_TRACE):
+        cg.add(var.set_trace(True))
+
+    # Bus scheduler is per physical bus, each mux channel is a bus of its own
+    root_bus_id = root_i2c_bus_id(config[CONF_I2C_ID])
+    if root_bus_id.id != config[CONF_I2C_ID].id:
+        cg.add(var.set_shared_bus(await cg.get_variable(root_bus_id)))
+
+    if interrupt_pin_config := config.get(CONF_INTERRUPT_PIN):
+        interrupt_pin = await cg.gpio_pin_expression(interrupt_pin_config)
+        cg.add(var.set_interrupt_pin(interrupt_pin))
+
+    if has_als(config):
+        cg.add(var.set_als_auto_mode(config[CONF_AUTO_MODE]))
+        cg.add(var.set_als_gain(config[CONF_GAIN]))
+        cg.add(var.set_als_integration_time(config[CONF_INTEGRATION_TIME]))
+        cg.add(var.set_als_meas_repeat_rate(config[CONF_REPEAT]))
+        cg.add(
+            var.set_als_glass_attenuation_factor(config[CONF_GLASS_ATTENUATION_FACTOR])
+        )
+        cg.add(var.set_als_float_lux_reference(config[CONF_FLOAT_LUX_REFERENCE]))
+        if config.get(CONF_ALS_STANDBY):
+            cg.add(var.set_als_standby(True))
+        if active_time_config := config.get(CONF_ALS_ACTIVE_TIME):
+            sens = await new_ltr_sensor(var, active_time_config)
+            cg.add(var.set_als_active_time_sensor(sens))
+        if adaptive_config := config.get(CONF_ADAPTIVE_SAMPLING):
+            cg.add(
+                var.set_adaptive_sampling(
+                    adaptive_config[CONF_MIN_INTERVAL],
+                    adaptive_config[CONF_MAX_INTERVAL],
+                    adaptive_config[CONF_CHANGE_THRESHOLD],
+                )
+            )
+        if report_on_change_config := config.get(CONF_ALS_REPORT_ON_CHANGE):
+            if CONF_PERCENT in report_on_change_config:
+                cg.add(
+                    var.set_als_report_on_change_percent(
+                        report_on_change_config[CONF_PERCENT]
+                    )
+                )
+            if CONF_LUX in report_on_change_config:
+                cg.add(
+                    var.set_als_report_on_change_lux(
+                        report_on_change_config[CONF_LUX]
+                    )
+                )
+        cg.add(
+            var.set_als_interrupt_persistence(config[CONF_ALS_INTERRUPT_PERSISTENCE])
+        )
 
-    cg.add(var.set_ps_cooldown_time_s(config[CONF_PS_COOLDOWN]))
-    cg.add(var.set_ps_gain(config[CONF_PS_GAIN]))
-    cg.add(var.set_ps_high_threshold(config[CONF_PS_HIGH_THRESHOLD]))
-    cg.add(var.set_ps_low_threshold(config[CONF_PS_LOW_THRESHOLD]))
+    if has_ps(config):
+        cg.add(var.set_ps_cooldown_time_s(config[CONF_PS_COOLDOWN]))
+        cg.add(var.set_ps_gain(config[CONF_PS_GAIN]))
+        cg.add(var.set_ps_measurement_rate(config[CONF_PS_MEASUREMENT_RATE]))
+        cg.add(var.set_ps_high_threshold(config[CONF_PS_HIGH_THRESHOLD]))
+        cg.add(var.set_ps_low_threshold(config[CONF_PS_LOW_THRESHOLD]))
+        cg.add(var.set_ps_led_current(config[CONF_PS_LED_CURRENT]))
+        cg.add(var.set_ps_led_duty(config[CONF_PS_LED_DUTY]))
+        cg.add(var.set_ps_led_frequency(config[CONF_PS_LED_FREQUENCY]))
+        cg.add(var.set_ps_pulses(config[CONF_PS_PULSES]))
+        if config.get(CONF_PS_LED_CONTROL):
+            cg.add(var.set_ps_led_control(True))
+        if led_charge_config := config.get(CONF_PS_LED_CHARGE):
+            sens = await new_ltr_sensor(var, led_charge_config)
+            cg.add(var.set_ps_led_charge_sensor(sens))
+        if calibration_config := config.get(CONF_PS_CALIBRATION):
+            cg.add(
+                var.set_ps_calibration(
+                    calibration_config[CONF_MARGIN],
+                    calibration_config[CONF_TRACKING_INTERVAL],
+                )
+            )
+        cg.add(
+            var.set_ps_interrupt_persistence(config[CONF_PS_INTERRUPT_PERSISTENCE])
+        )
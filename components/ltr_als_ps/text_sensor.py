@@ -0,0 +1,65 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+import esphome.final_validate as fv
+from esphome.components import text_sensor
+from esphome.const import (
+    CONF_TYPE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    ICON_COUNTER,
+    ICON_TIMER,
+)
+
+from .sensor import LTRAlsPsComponent, has_als
+
+CONF_LTR_ALS_PS_ID = "ltr_als_ps_id"
+CONF_STATE_TIMES = "state_times"
+CONF_AUTO_RANGE_HISTOGRAM = "auto_range_histogram"
+
+CONFIG_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.GenerateID(CONF_LTR_ALS_PS_ID): cv.use_id(LTRAlsPsComponent),
+            # time loop() spent in each state over the last minute, busiest first
+            cv.Optional(CONF_STATE_TIMES): text_sensor.text_sensor_schema(
+                icon=ICON_TIMER,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            # samples by number of auto-range adjustments they needed, totals
+            cv.Optional(CONF_AUTO_RANGE_HISTOGRAM): text_sensor.text_sensor_schema(
+                icon=ICON_COUNTER,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+        }
+    ),
+    cv.has_at_least_one_key(CONF_STATE_TIMES, CONF_AUTO_RANGE_HISTOGRAM),
+)
+
+
+def final_validate_parent_type(config):
+    if CONF_AUTO_RANGE_HISTOGRAM not in config:
+        return config
+    full_config = fv.full_config.get()
+    path = full_config.get_path_for_id(config[CONF_LTR_ALS_PS_ID])[:-1]
+    parent_config = full_config.get_config_for_path(path)
+    if not has_als(parent_config):
+        raise cv.Invalid(
+            f"Auto-range histogram needs ALS, {parent_config[CONF_TYPE]} sensor has none",
+            path=[CONF_AUTO_RANGE_HISTOGRAM],
+        )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = final_validate_parent_type
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_LTR_ALS_PS_ID])
+
+    cg.add_define("USE_LTR_DIAGNOSTICS")
+    cg.add_define("USE_LTR_DIAGNOSTICS_TEXT")
+    if state_times_config := config.get(CONF_STATE_TIMES):
+        sens = await text_sensor.new_text_sensor(state_times_config)
+        cg.add(parent.set_state_times_text_sensor(sens))
+    if histogram_config := config.get(CONF_AUTO_RANGE_HISTOGRAM):
+        sens = await text_sensor.new_text_sensor(histogram_config)
+        cg.add(parent.set_auto_range_histogram_text_sensor(sens))
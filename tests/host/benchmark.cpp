@@ -0,0 +1,659 @@
+//
+// Scenario benchmark for the ltr_als_ps component on the host: real component code, stubbed
+// ESPHome core with virtual time, register level chip simulator on a simulated I2C bus.
+//
+//   ltr_benchmark            full scenarios and report
+//   ltr_benchmark --quick    shortened scenarios with pass/fail checks (ctest)
+//   ltr_benchmark --verbose  component log at DEBUG level
+//
+// Per scenario it reports I2C transactions and bytes per published sample, host CPU time spent
+// in the component loop(), bus time, time to the first publish and auto-range convergence time
+// after light steps (first published value within 5% of the scene).
+//
+#include "esphome/core/application.h"
+#include "esphome/core/log.h"
+#include "ltr_als_ps/ltr_als_ps.h"
+#include "ltr_chip_sim.h"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::ltr_als_ps;
+using ltr_sim::LtrChipSim;
+using ltr_sim::SimBus;
+
+namespace {
+
+bool quick = false;  // NOLINT
+int failures = 0;    // NOLINT
+
+void check(bool condition, const char *scenario, const char *what) {
+  if (condition)
+    return;
+  std::printf("  FAIL [%s] %s\n", scenario, what);
+  failures++;
+}
+
+//
+// One sensor with its chip. Buses are never freed: bus scheduler registry is keyed by bus
+// pointer, a bus allocated at a reused address would inherit a stale scheduler.
+//
+struct Rig {
+  LtrChipSim *chip;
+  SimBus *bus;
+  LTRAlsPsComponent *ltr;
+  sensor::Sensor *lux{nullptr};
+  sensor::Sensor *ps{nullptr};
+  InternalGPIOPin *pin{nullptr};
+  LTRPsHighTrigger *ps_high{nullptr};
+  LTRPsLowTrigger *ps_low{nullptr};
+};
+
+Rig make_rig(LtrChipSim::Part part, uint32_t update_interval_ms, SimBus *bus = nullptr) {
+  Rig rig{};
+  rig.chip = new LtrChipSim(part);
+  rig.bus = bus != nullptr ? bus : new SimBus();
+  rig.bus->add_device(rig.chip);
+  rig.ltr = new LTRAlsPsComponent();
+  rig.ltr->set_i2c_bus(rig.bus);
+  rig.ltr->set_i2c_address(rig.chip->get_address());
+  rig.ltr->set_update_interval(update_interval_ms);
+  rig.ltr->set_ltr_type(part == LtrChipSim::Part::LTR_303 ? LTR_TYPE_ALS_ONLY : LTR_TYPE_ALS_AND_PS);
+  rig.ltr->set_als_auto_mode(true);
+  rig.ltr->set_als_gain(AlsGain::GAIN_1);
+  rig.ltr->set_als_integration_time(IntegrationTime::INTEGRATION_TIME_100MS);
+  rig.ltr->set_als_meas_repeat_rate(MeasurementRepeatRate::REPEAT_RATE_500MS);
+  rig.ltr->set_als_glass_attenuation_factor(1.0f);
+  rig.lux = new sensor::Sensor("lux");
+  rig.ltr->set_ambient_light_sensor(rig.lux);
+  if (part == LtrChipSim::Part::LTR_553) {
+    rig.ps = new sensor::Sensor("ps");
+    rig.ltr->set_proximity_counts_sensor(rig.ps);
+    rig.ltr->set_ps_high_threshold(600);
+    rig.ltr->set_ps_low_threshold(300);
+    rig.ltr->set_ps_cooldown_time_s(1);
+    rig.ltr->set_ps_measurement_rate(PsMeasurementRate::PS_MEAS_RATE_50MS);
+    rig.ltr->set_ps_gain(PsGain::PS_GAIN_16);
+    rig.ltr->set_ps_led_current(PsLedCurrent::PS_LED_CURRENT_100MA);
+    rig.ltr->set_ps_led_duty(PsLedDuty::PS_LED_DUTY_100);
+    rig.ltr->set_ps_led_frequency(PsLedFreq::PS_LED_FREQ_60KHZ);
+    rig.ltr->set_ps_pulses(1);
+    rig.ps_high = new LTRPsHighTrigger(rig.ltr);
+    rig.ps_low = new LTRPsLowTrigger(rig.ltr);
+  }
+  return rig;
+}
+
+void use_interrupt_pin(Rig &rig) {
+  rig.pin = new InternalGPIOPin();
+  rig.chip->set_int_pin(rig.pin);
+  rig.ltr->set_interrupt_pin(rig.pin);
+}
+
+//
+// Runs the registered components, measures host CPU time in the component loop()
+//
+struct Run {
+  std::vector<Rig> rigs;
+  std::vector<SimBus *> buses;
+  double loop_cpu_ns{0};
+  double loop_cpu_max_ns{0};
+  uint64_t loop_calls{0};
+  uint64_t loop_bus_max_us{0};  // virtual time, longest bus activity in a single loop() pass
+
+  void start() {
+    for (auto &rig : this->rigs)
+      App.register_component(rig.ltr);
+    App.set_loop_wrapper([this](Component *component) {
+      auto started = std::chrono::steady_clock::now();
+      uint64_t started_us = App.now_us();
+      component->loop();
+      double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+      this->loop_bus_max_us = std::max(this->loop_bus_max_us, App.now_us() - started_us);
+      this->loop_cpu_ns += ns;
+      this->loop_cpu_max_ns = std::max(this->loop_cpu_max_ns, ns);
+      this->loop_calls++;
+    });
+    App.setup();
+  }
+
+  void run_until(uint32_t ms) {
+    App.run_until(ms, [this]() {
+      for (auto &rig : this->rigs)
+        rig.chip->tick();
+    });
+  }
+};
+
+struct Step {
+  uint32_t at_ms;
+  float lux;
+};
+
+// Light that follows the steps, constant in between
+std::function<float(uint32_t)> step_light(std::vector<Step> steps) {
+  return [steps](uint32_t ms) {
+    float lux = steps.front().lux;
+    for (auto &step : steps) {
+      if (ms >= step.at_ms)
+        lux = step.lux;
+    }
+    return lux;
+  };
+}
+
+// Counts component log messages starting with the prefix while alive, e.g. data timeouts
+struct LogCounter {
+  size_t count{0};
+  explicit LogCounter(const char *prefix) {
+    host::log_listener = [this, prefix](int, const char *tag, const char *message) {
+      if (std::strncmp(message, prefix, std::strlen(prefix)) == 0)
+        this->count++;
+      std::printf("[%9.3f][%s] %s\n", App.now_us() / 1e6, tag, message);
+    };
+  }
+  ~LogCounter() { host::log_listener = nullptr; }
+};
+
+bool within(float value, float reference, float tolerance) {
+  return std::fabs(value - reference) <= tolerance * std::max(reference, 0.01f);
+}
+
+// First publish at or after from_ms that lands within 5% of the reference, -1 if none
+int32_t convergence_ms(const sensor::Sensor *sensor, uint32_t from_ms, uint32_t to_ms, float reference) {
+  for (auto &publish : sensor->get_history()) {
+    if (publish.ms < from_ms || publish.ms >= to_ms)
+      continue;
+    if (within(publish.value, reference, 0.05f))
+      return publish.ms - from_ms;
+  }
+  return -1;
+}
+
+void report(const char *name, const Run &run, size_t publishes, uint32_t first_publish_ms) {
+  uint32_t transactions = 0, bytes = 0, errors = 0;
+  uint64_t busy_us = 0;
+  for (auto *bus : run.buses) {
+    transactions += bus->get_stats().transactions;
+    bytes += bus->get_stats().bytes;
+    errors += bus->get_stats().errors;
+    busy_us += bus->get_stats().busy_us;
+  }
+  double per_publish = publishes > 0 ? double(transactions) / publishes : 0.0;
+  double bytes_per_publish = publishes > 0 ? double(bytes) / publishes : 0.0;
+  std::printf("  %-22s publishes %6zu | i2c %7u tx (%5.1f/publish, %6.1f B/publish, %u err) | bus %8.1f ms\n", name,
+              publishes, transactions, per_publish, bytes_per_publish, errors, busy_us / 1000.0);
+  std::printf("  %-22s first publish %6u ms | loop() %9llu calls, avg %6.0f ns, max %8.0f ns\n", "", first_publish_ms,
+              static_cast<unsigned long long>(run.loop_calls), run.loop_calls ? run.loop_cpu_ns / run.loop_calls : 0.0,
+              run.loop_cpu_max_ns);
+}
+
+uint32_t first_publish_ms(const sensor::Sensor *sensor) {
+  return sensor->get_history().empty() ? 0 : sensor->get_history().front().ms;
+}
+
+//
+// Scenarios
+//
+void steady_office() {
+  const char *name = "steady office 300 lx";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_303, 1000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  rig.chip->set_light([](uint32_t) { return 300.0f; });
+  rig.chip->set_noise(0.002f);
+  run.start();
+  run.run_until(quick ? 30000 : 600000);
+
+  report(name, run, rig.lux->get_history().size(), first_publish_ms(rig.lux));
+  check(!rig.ltr->is_failed(), name, "component failed");
+  check(!rig.lux->get_history().empty(), name, "nothing published");
+  check(first_publish_ms(rig.lux) < 2500, name, "first publish later than 2.5 s");
+  check(within(rig.lux->get_state(), 300.0f, 0.02f), name, "lux off by more than 2%");
+}
+
+void light_steps() {
+  const char *name = "dark/sun/dark steps";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_303, 1000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  std::vector<Step> steps = {{0, 1.0f}, {20000, 50000.0f}, {40000, 1.0f}, {60000, 800.0f}};
+  rig.chip->set_light(step_light(steps));
+  auto *state_times = new text_sensor::TextSensor("state times");
+  auto *histogram = new text_sensor::TextSensor("histogram");
+  rig.ltr->set_state_times_text_sensor(state_times);
+  rig.ltr->set_auto_range_histogram_text_sensor(histogram);
+  run.start();
+  run.run_until(80000);
+
+  report(name, run, rig.lux->get_history().size(), first_publish_ms(rig.lux));
+  for (size_t i = 1; i < steps.size(); i++) {
+    uint32_t to_ms = i + 1 < steps.size() ? steps[i + 1].at_ms : 80000;
+    int32_t settle = convergence_ms(rig.lux, steps[i].at_ms, to_ms, steps[i].lux);
+    std::printf("  %-22s step %8.1f -> %8.1f lx converged in %6d ms\n", "", steps[i - 1].lux, steps[i].lux, settle);
+    check(settle >= 0 && settle < 8000, name, "auto-range did not converge within 8 s");
+  }
+  std::printf("  %-22s %u ALS samples, %u saturated, %u register writes\n", "", rig.chip->get_stats().als_samples,
+              rig.chip->get_stats().als_saturated, rig.chip->get_stats().register_writes);
+  check(!rig.ltr->is_failed(), name, "component failed");
+  std::printf("  %-22s state times: %s\n", "", state_times->state.c_str());
+  std::printf("  %-22s adjustments per sample: %s\n", "", histogram->state.c_str());
+  check(!state_times->get_history().empty() && !state_times->state.empty(), name, "state times not published");
+  check(!histogram->get_history().empty() && histogram->state.rfind("0:", 0) == 0 &&
+            histogram->state.find(" 1:0 ") == std::string::npos,
+        name, "adjustment histogram not published");
+}
+
+void dusk_ramp() {
+  const char *name = "dusk ramp 20k -> 0.5 lx";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_303, 10000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  const uint32_t duration_ms = quick ? 10 * 60000 : 60 * 60000;
+  auto light = [duration_ms](uint32_t ms) {
+    float t = std::min(1.0f, float(ms) / duration_ms);
+    return 20000.0f * std::pow(0.5f / 20000.0f, t);
+  };
+  rig.chip->set_light(light, 0.4f);
+  rig.chip->set_noise(0.002f);
+  run.start();
+  run.run_until(duration_ms);
+
+  report(name, run, rig.lux->get_history().size(), first_publish_ms(rig.lux));
+  float worst = 0.0f;
+  for (auto &publish : rig.lux->get_history()) {
+    // light moves a few % per update interval, compare against the scene within it
+    float error = std::fabs(publish.value - light(publish.ms)) / light(publish.ms);
+    worst = std::max(worst, error);
+  }
+  std::printf("  %-22s worst error vs scene %.1f%%, %u register writes\n", "", worst * 100.0f,
+              rig.chip->get_stats().register_writes);
+  check(worst < 0.15f, name, "published lux deviates from the scene by more than 15%");
+}
+
+void flaky_bus() {
+  const char *name = "flaky bus, 1/40 NACK";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_303, 1000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  rig.bus->set_nack_every(40);
+  rig.bus->set_extra_latency_us(200);
+  rig.chip->set_light([](uint32_t) { return 120.0f; });
+  run.start();
+  run.run_until(quick ? 60000 : 600000);
+
+  report(name, run, rig.lux->get_history().size(), first_publish_ms(rig.lux));
+  check(!rig.ltr->is_failed(), name, "component failed on transient NACKs");
+  check(rig.lux->get_history().size() > (quick ? 30u : 300u), name, "publishing stalled");
+  check(within(rig.lux->get_state(), 120.0f, 0.02f), name, "lux off by more than 2%");
+}
+
+// Fixed address part, so a bigger rig only works behind a mux: 8 sensors on the channels of
+// one TCA9548A, polling proximity. With the scheduler shared across the mux, status polls
+// are rationed and ALS cycles are staggered over the frame.
+uint32_t mux_rig(bool shared) {
+  const char *name = shared ? "8x behind mux, shared" : "8x behind mux, per channel";
+  App.reset();
+  Run run;
+  auto *root = new SimBus();
+  run.buses.push_back(root);
+  for (uint8_t channel = 0; channel < 8; channel++) {
+    auto *bus = new SimBus(root, channel);
+    auto rig = make_rig(LtrChipSim::Part::LTR_553, 2000, bus);
+    if (shared)
+      rig.ltr->set_shared_bus(root);
+    rig.chip->set_light([channel](uint32_t) { return 50.0f + 100.0f * channel; });
+    rig.chip->set_proximity([](uint32_t) { return 80.0f; });
+    run.rigs.push_back(rig);
+  }
+  run.start();
+  run.run_until(quick ? 60000 : 600000);
+
+  size_t publishes = 0;
+  bool all_ok = true;
+  for (size_t i = 0; i < run.rigs.size(); i++) {
+    publishes += run.rigs[i].lux->get_history().size();
+    all_ok &= within(run.rigs[i].lux->get_state(), 50.0f + 100.0f * i, 0.02f);
+  }
+  report(name, run, publishes, first_publish_ms(run.rigs[0].lux));
+  std::printf("  %-22s %u mux channel switches\n", "", root->get_mux_switches());
+  check(all_ok, name, "lux off by more than 2%");
+  return root->get_stats().transactions;
+}
+
+// Two fixed address sensors behind a mux, one in the dark and one in sunlight, settle on different
+// ranges and proximity offsets. After a reboot each has to come up with its own, not the ones saved last.
+void mux_restore() {
+  const char *name = "2x behind mux, restore";
+  const float light[] = {1.0f, 20000.0f};
+  const float crosstalk[] = {60.0f, 250.0f};
+  uint8_t settled[2]{};
+  uint8_t restored[2]{};
+  uint16_t settled_offset[2]{};
+  uint16_t restored_offset[2]{};
+  App.reset();
+  for (bool reboot : {false, true}) {
+    if (reboot)
+      App.reset(true);
+    Run run;
+    auto *root = new SimBus();
+    run.buses.push_back(root);
+    for (uint8_t channel = 0; channel < 2; channel++) {
+      auto rig = make_rig(LtrChipSim::Part::LTR_553, 1000, new SimBus(root, channel));
+      rig.ltr->set_shared_bus(root);
+      rig.ltr->set_preference_id(channel == 0 ? "ltr_dark" : "ltr_sunlit");
+      rig.ltr->set_ps_calibration(10, 0);
+      float lux = light[channel];
+      float counts = crosstalk[channel];
+      rig.chip->set_light([lux](uint32_t) { return lux; });
+      rig.chip->set_proximity([counts](uint32_t) { return counts; });
+      run.rigs.push_back(rig);
+    }
+    run.start();
+    // restored range and offset are programmed during setup, before the first sample
+    run.run_until(reboot ? 500 : 20000);
+    for (uint8_t i = 0; i < 2; i++) {
+      auto *chip = run.rigs[i].chip;
+      // ALS_CONTR gain bits, MEAS_RATE integration time bits
+      (reboot ? restored : settled)[i] = (chip->peek(0x80) & 0x1C) | (chip->peek(0x85) & 0x38) << 2;
+      // PS_OFFSET_1 and PS_OFFSET_0
+      (reboot ? restored_offset : settled_offset)[i] = (chip->peek(0x94) & 0x03) << 8 | chip->peek(0x95);
+    }
+    if (reboot) {
+      run.run_until(5000);
+      report(name, run, run.rigs[0].lux->get_history().size() + run.rigs[1].lux->get_history().size(),
+             first_publish_ms(run.rigs[0].lux));
+    }
+  }
+  std::printf("  %-22s settled ranges 0x%02X 0x%02X, restored 0x%02X 0x%02X\n", "", settled[0], settled[1],
+              restored[0], restored[1]);
+  std::printf("  %-22s settled PS offsets %u %u, restored %u %u\n", "", settled_offset[0], settled_offset[1],
+              restored_offset[0], restored_offset[1]);
+  check(settled[0] != settled[1], name, "sensors settled on the same range");
+  check(restored[0] == settled[0] && restored[1] == settled[1], name, "restored range of another sensor");
+  check(settled_offset[0] != settled_offset[1], name, "sensors calibrated to the same PS offset");
+  check(restored_offset[0] == settled_offset[0] && restored_offset[1] == settled_offset[1], name,
+        "restored PS offset of another sensor");
+}
+
+// Hand passes over the sensor for 2 s every 10 s
+float hand_wave(uint32_t ms) { return ms % 10000 >= 5000 && ms % 10000 < 7000 ? 1500.0f : 80.0f; }
+
+void proximity(bool interrupt) {
+  const char *name = interrupt ? "hand wave, INT pin" : "hand wave, polling";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_553, 1000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  if (interrupt)
+    use_interrupt_pin(rig);
+  rig.chip->set_light([](uint32_t) { return 300.0f; });
+  rig.chip->set_proximity(hand_wave);
+  run.start();
+  const uint32_t duration_ms = quick ? 60000 : 600000;
+  run.run_until(duration_ms);
+
+  report(name, run, rig.lux->get_history().size() + rig.ps->get_history().size(), first_publish_ms(rig.ps));
+  uint32_t waves = (duration_ms - 5000) / 10000 + 1;
+  std::printf("  %-22s %u waves, high trigger %u, low trigger %u\n", "", waves, rig.ps_high->get_count(),
+              rig.ps_low->get_count());
+  check(!rig.ltr->is_failed(), name, "component failed");
+  check(rig.ps_high->get_count() == waves, name, "missed or extra proximity high triggers");
+  check(within(rig.lux->get_state(), 300.0f, 0.02f), name, "lux off by more than 2%");
+}
+
+// INT pin, the write moving the interrupt window away from the approaching hand is dropped after
+// all retries. Chip keeps the old window, the next sample has to queue the new one again.
+void proximity_window_dropped() {
+  const char *name = "INT pin, window dropped";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_553, 1000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  use_interrupt_pin(rig);
+  rig.chip->set_light([](uint32_t) { return 300.0f; });
+  rig.chip->set_proximity(hand_wave);
+  run.start();
+  run.run_until(4900);
+  rig.bus->set_nack_writes_to(0x90, 5);  // PS_THRES_UP_0, MAX_TRIES
+  run.run_until(6500);
+  // hand is close: upper threshold out of reach, only going away can trigger
+  uint16_t high = rig.chip->peek(0x91) << 8 | rig.chip->peek(0x90);
+  run.run_until(quick ? 30000 : 120000);
+
+  report(name, run, rig.ps->get_history().size(), first_publish_ms(rig.ps));
+  std::printf("  %-22s upper threshold %u with the hand close, high trigger %u, low trigger %u\n", "", high,
+              rig.ps_high->get_count(), rig.ps_low->get_count());
+  check(high == 0x7ff, name, "dropped interrupt window was never written again");
+  check(rig.ps_high->get_count() == rig.ps_low->get_count(), name, "missed proximity triggers");
+}
+
+// Slow bus (clock stretching or a long mux chain), ALS and PS polling with deferred register writes
+// queued. Writes are flushed one run per pass and never share it with a state, so the longest pass is
+// the sample read: status first, then the data registers - two register reads.
+void slow_bus(bool interrupt) {
+  const char *name = interrupt ? "slow bus, INT pin" : "slow bus, polling";
+  const uint32_t latency_us = 2000;
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_553, 1000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  if (interrupt)
+    use_interrupt_pin(rig);
+  rig.bus->set_extra_latency_us(latency_us);
+  rig.ltr->set_ps_calibration(10, 5000);
+  std::vector<Step> steps = {{0, 5.0f}, {10000, 30000.0f}, {20000, 40.0f}};
+  rig.chip->set_light(step_light(steps));
+  rig.chip->set_proximity(hand_wave);
+  run.start();
+  run.run_until(quick ? 30000 : 120000);
+
+  report(name, run, rig.lux->get_history().size() + rig.ps->get_history().size(), first_publish_ms(rig.lux));
+  std::printf("  %-22s longest loop() pass on the bus %llu us, %u us added per bus operation\n", "",
+              (unsigned long long) run.loop_bus_max_us, latency_us);
+  check(!rig.ltr->is_failed(), name, "component failed");
+  // register read is a pointer write and a read, latency on each, plus a few bytes at 100 kHz
+  check(run.loop_bus_max_us < 5 * latency_us, name, "loop() pass did more than two register reads");
+  check(within(rig.lux->get_state(), 40.0f, 0.05f), name, "lux off by more than 5%");
+}
+
+// Presence 3 of 5 samples (50 ms apart): a hand brushes past, then comes back and stays for 2 s.
+// The brush sample drops out of the window before the approach completes, latency must not count it.
+void presence_latency() {
+  const char *name = "presence, brush first";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_553, 1000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  auto *presence = new binary_sensor::BinarySensor("presence");
+  auto *latency = new sensor::Sensor("latency");
+  rig.ltr->set_presence_binary_sensor(presence);
+  rig.ltr->set_presence_latency_sensor(latency);
+  rig.ltr->set_presence(400, 300, 3, 5, 0);
+  rig.chip->set_light([](uint32_t) { return 300.0f; });
+  rig.chip->set_proximity([](uint32_t ms) {
+    uint32_t t = ms % 10000;
+    bool close = (t >= 5000 && t < 5050) || (t >= 5200 && t < 5250) || (t >= 5300 && t < 7300);
+    return close ? 1500.0f : 80.0f;
+  });
+  run.start();
+  run.run_until(quick ? 30000 : 120000);
+
+  report(name, run, presence->get_history().size(), first_publish_ms(rig.ps));
+  float worst = 0.0f;
+  for (auto &publish : latency->get_history())
+    worst = std::max(worst, publish.value);
+  std::printf("  %-22s %zu presence changes, worst detection latency %.0f ms\n", "", presence->get_history().size(),
+              worst);
+  check(!latency->get_history().empty(), name, "presence never detected");
+  // 3 samples 50 ms apart plus polling jitter; counting from the brush would be 350 ms
+  check(worst <= 200.0f, name, "latency counted from a hit no longer in the window");
+}
+
+// PS only with a deadband: suppressed publishes are reported although no ALS cycle ever runs
+void ps_only_deadband() {
+  const char *name = "PS only, deadband";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_553, 1000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  rig.ltr->set_ltr_type(LTR_TYPE_PS_ONLY);
+  rig.ltr->set_ambient_light_sensor(nullptr);
+  rig.ltr->set_sensor_deadband(rig.ps, 50.0f, 0.0f, 60000);
+  auto *suppressed = new sensor::Sensor("suppressed");
+  rig.ltr->set_suppressed_publishes_sensor(suppressed);
+  rig.chip->set_proximity(hand_wave);
+  rig.chip->set_noise(0.05f);
+  run.start();
+  run.run_until(quick ? 30000 : 300000);
+
+  report(name, run, rig.ps->get_history().size(), first_publish_ms(rig.ps));
+  std::printf("  %-22s %.0f publishes suppressed\n", "", suppressed->get_state());
+  check(suppressed->has_state() && suppressed->get_state() > 0, name, "suppressed publishes not reported");
+}
+
+// Dim light slows the chip down and lets auto-ranging use long integration times, a sudden
+// change restores the fast repeat rate: integration time must never exceed it in MEAS_RATE
+void adaptive_sampling() {
+  const char *name = "adaptive sampling";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_303, 1000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  rig.ltr->set_als_meas_repeat_rate(MeasurementRepeatRate::REPEAT_RATE_100MS);
+  rig.ltr->set_adaptive_sampling(200, 16000, 0.2f);
+  std::vector<Step> steps = {{0, 3.0f}, {60000, 0.5f}, {90000, 400.0f}};
+  rig.chip->set_light(step_light(steps));
+  LogCounter timeouts("Can't get data");
+  run.start();
+
+  uint32_t invalid_ms = 0;
+  for (uint32_t ms = 0; ms < 120000; ms += 50) {
+    run.run_until(ms);
+    uint8_t meas = rig.chip->peek(0x85);
+    uint16_t itime_ms = std::array<uint16_t, 8>{100, 50, 200, 400, 150, 250, 300, 350}[(meas >> 3) & 0b111];
+    uint16_t repeat_ms = std::array<uint16_t, 8>{50, 100, 200, 500, 1000, 2000, 2000, 2000}[meas & 0b111];
+    if (itime_ms > repeat_ms)
+      invalid_ms += 50;
+  }
+
+  report(name, run, rig.lux->get_history().size(), first_publish_ms(rig.lux));
+  std::printf("  %-22s integration time longer than repeat rate for %u ms\n", "", invalid_ms);
+  std::printf("  %-22s %zu data timeouts\n", "", timeouts.count);
+  check(invalid_ms == 0, name, "integration time exceeds repeat rate");
+  // chip finishes the cycle it is in at the old repeat rate, that's not a timeout
+  check(timeouts.count == 0, name, "data timeouts after repeat rate changes");
+  // the step may land in the middle of a 16 s interval
+  check(convergence_ms(rig.lux, steps[2].at_ms, 120000, steps[2].lux) >= 0, name, "did not converge after the step");
+}
+
+// Chip stops delivering ALS data for a while: every update times out waiting for it, in standby
+// mode the chip has to go back to standby after each timeout instead of measuring till the end
+void standby_dropout() {
+  const char *name = "standby, data dropout";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_303, 5000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  rig.ltr->set_als_standby(true);
+  rig.chip->set_light([](uint32_t) { return 300.0f; });
+  const uint32_t dropout_from_ms = 20000, dropout_to_ms = 60000;
+  rig.chip->set_als_dropout(dropout_from_ms, dropout_to_ms);
+  run.start();
+
+  uint32_t active_ms = 0;
+  for (uint32_t ms = 0; ms < 80000; ms += 50) {
+    run.run_until(ms);
+    if (ms >= dropout_from_ms && ms < dropout_to_ms && (rig.chip->peek(0x80) & 0b1))
+      active_ms += 50;
+  }
+
+  report(name, run, rig.lux->get_history().size(), first_publish_ms(rig.lux));
+  float active = float(active_ms) / (dropout_to_ms - dropout_from_ms);
+  std::printf("  %-22s ALS active %.0f%% of the dropout\n", "", active * 100.0f);
+  // each 5 s update wakes the chip and waits 2 periods plus integration time before giving up
+  check(active < 0.5f, name, "chip left measuring after data timeouts");
+  check(convergence_ms(rig.lux, dropout_to_ms, 80000, 300.0f) >= 0, name, "no data after the dropout");
+}
+
+// Report on change notices the change, then the chip stops delivering: the abandoned cycle must
+// not leave the change pending, or cycles restart back to back for as long as data is missing
+void report_on_change_dropout() {
+  const char *name = "on change, data dropout";
+  App.reset();
+  Run run;
+  run.rigs.push_back(make_rig(LtrChipSim::Part::LTR_303, 1000));
+  run.buses.push_back(run.rigs[0].bus);
+  auto &rig = run.rigs[0];
+  rig.ltr->set_als_report_on_change_percent(0.1f);
+  rig.chip->set_light(step_light({{0, 300.0f}, {19000, 3000.0f}}));
+  rig.chip->set_als_dropout(20000, 50000);
+  LogCounter timeouts("Can't get data");
+  run.start();
+  run.run_until(60000);
+
+  report(name, run, rig.lux->get_history().size(), first_publish_ms(rig.lux));
+  std::printf("  %-22s %zu data timeouts in a 30 s dropout\n", "", timeouts.count);
+  check(timeouts.count <= 1, name, "abandoned cycle restarted back to back");
+  check(within(rig.lux->get_state(), 3000.0f, 0.05f), name, "change not reported");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--quick") == 0)
+      quick = true;
+    if (std::strcmp(argv[i], "--verbose") == 0)
+      host::log_level = host::LOG_DEBUG;
+  }
+
+  std::printf("ltr_als_ps host benchmark%s\n", quick ? " (quick)" : "");
+  steady_office();
+  light_steps();
+  dusk_ramp();
+  flaky_bus();
+  uint32_t per_channel = mux_rig(false);
+  uint32_t shared = mux_rig(true);
+  check(shared < per_channel * 3 / 4, "8x behind mux", "status polls are not rationed across the mux");
+  mux_restore();
+  proximity(false);
+  proximity(true);
+  proximity_window_dropped();
+  slow_bus(false);
+  slow_bus(true);
+  presence_latency();
+  ps_only_deadband();
+  adaptive_sampling();
+  standby_dropout();
+  report_on_change_dropout();
+
+  if (failures > 0) {
+    std::printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
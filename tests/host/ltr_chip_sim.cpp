@@ -0,0 +1,425 @@
+#include "ltr_chip_sim.h"
+
+#include "esphome/core/application.h"
+#include "ltr_als_ps/ltr_definitions.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ltr_sim {
+
+using namespace esphome::ltr_als_ps;
+using esphome::App;
+
+static uint8_t idx(CommandRegisters reg) { return static_cast<uint8_t>(reg) & 0x7F; }
+
+static const uint8_t GAIN_VALUES[8] = {1, 2, 4, 8, 1, 1, 48, 96};
+static const uint16_t ITIME_MS[8] = {100, 50, 200, 400, 150, 250, 300, 350};
+static const uint16_t REPEAT_MS[8] = {50, 100, 200, 500, 1000, 2000, 2000, 2000};
+static const uint16_t PS_RATE_MS[16] = {50, 70, 100, 200, 500, 1000, 2000, 2000, 10, 10, 10, 10, 10, 10, 10, 10};
+static const uint8_t LED_CURRENT_MA[8] = {5, 10, 20, 50, 100, 100, 100, 100};
+
+static const uint32_t ALS_WAKEUP_US = 10000;  // datasheet: standby -> active, 10 ms
+static const uint32_t PS_WAKEUP_US = 10000;
+
+LtrChipSim::LtrChipSim(Part part) : part_(part) {
+  this->address_ = part == Part::LTR_303 ? 0x29 : 0x23;
+  this->reset_registers_();
+}
+
+void LtrChipSim::reset_registers_() {
+  std::fill(std::begin(this->regs_), std::end(this->regs_), 0);
+  this->regs_[idx(CommandRegisters::PART_ID)] = this->part_ == Part::LTR_303 ? 0xA0 : 0x92;
+  this->regs_[idx(CommandRegisters::MANUFAC_ID)] = 0x05;
+  this->regs_[idx(CommandRegisters::MEAS_RATE)] = 0x03;
+  this->regs_[idx(CommandRegisters::ALS_THRES_UP_0)] = 0xFF;
+  this->regs_[idx(CommandRegisters::ALS_THRES_UP_1)] = 0xFF;
+  this->regs_[idx(CommandRegisters::ALS_PS_INTERRUPT)] = 0x08;
+  if (this->part_ == Part::LTR_553) {
+    this->regs_[idx(CommandRegisters::PS_LED)] = 0x7F;
+    this->regs_[idx(CommandRegisters::PS_N_PULSES)] = 0x01;
+    this->regs_[idx(CommandRegisters::PS_MEAS_RATE)] = 0x02;
+    this->regs_[idx(CommandRegisters::PS_THRES_UP_0)] = 0xFF;
+    this->regs_[idx(CommandRegisters::PS_THRES_UP_1)] = 0x07;
+  }
+  this->als_ = {};
+  this->ps_ = {};
+  this->set_int_(false);
+}
+
+float LtrChipSim::lux_to_ch0(float lux, float ir_ratio, float gain, float itime_ms) {
+  // inverse of the datasheet formula for ratio < 0.45: lux = (1.7743 * ch0 + 1.1059 * ch1) / gain / itime
+  return lux * gain * (itime_ms / 100.0f) / (1.7743f + 1.1059f * ir_ratio);
+}
+
+float LtrChipSim::noise_factor_() {
+  if (this->noise_ == 0.0f)
+    return 1.0f;
+  this->noise_state_ = this->noise_state_ * 1664525u + 1013904223u;
+  float u = (this->noise_state_ >> 8) / float(1u << 24);  // 0..1
+  return 1.0f + this->noise_ * (2.0f * u - 1.0f);
+}
+
+void LtrChipSim::set_int_(bool asserted) {
+  if (this->int_asserted_ == asserted)
+    return;
+  this->int_asserted_ = asserted;
+  if (this->int_pin_ == nullptr)
+    return;
+  InterruptRegister intr{};
+  intr.raw = this->regs_[idx(CommandRegisters::ALS_PS_INTERRUPT)];
+  bool active_high = intr.interrupt_polarity;
+  this->int_pin_->digital_write(asserted == active_high);
+}
+
+void LtrChipSim::tick() {
+  uint64_t now = App.now_us();
+  if (this->reset_until_us_ != 0 && now >= this->reset_until_us_) {
+    this->reset_until_us_ = 0;
+    this->reset_registers_();
+  }
+  this->update_als_(now);
+  this->update_ps_(now);
+}
+
+//
+// ALS: a cycle latches gain and integration time when it starts, so writes made while a cycle
+// is in progress show up in the data one full cycle later, as on the real chip.
+//
+void LtrChipSim::update_als_(uint64_t now_us) {
+  while (this->als_.active) {
+    if (!this->als_.latched) {
+      if (this->als_.start_us > now_us)
+        return;
+      AlsControlRegister ctrl{};
+      ctrl.raw = this->regs_[idx(CommandRegisters::ALS_CONTR)];
+      MeasurementRateRegister rate{};
+      rate.raw = this->regs_[idx(CommandRegisters::MEAS_RATE)];
+      this->als_.gain = ctrl.gain;
+      this->als_.itime_ms = ITIME_MS[rate.integration_time];
+      this->als_.period_ms = std::max(REPEAT_MS[rate.measurement_repeat_rate], this->als_.itime_ms);
+      this->als_.range_changed =
+          this->als_.gain != this->als_.last_gain || this->als_.itime_ms != this->als_.last_itime_ms;
+      this->als_.last_gain = this->als_.gain;
+      this->als_.last_itime_ms = this->als_.itime_ms;
+      this->als_.latched = true;
+    }
+    uint64_t end_us = this->als_.start_us + uint64_t(this->als_.itime_ms) * 1000;
+    if (end_us > now_us)
+      return;
+    uint32_t end_ms = end_us / 1000;
+    if (end_ms < this->als_dropout_from_ms_ || end_ms >= this->als_dropout_to_ms_)
+      this->produce_als_sample_(end_us);
+    this->als_.start_us += uint64_t(this->als_.period_ms) * 1000;
+    this->als_.latched = false;
+  }
+}
+
+void LtrChipSim::produce_als_sample_(uint64_t at_us) {
+  uint32_t mid_ms = (at_us - uint64_t(this->als_.itime_ms) * 500) / 1000;
+  float lux = this->lux_ ? std::max(0.0f, this->lux_(mid_ms)) : 0.0f;
+  float ch0 = lux_to_ch0(lux, this->ir_ratio_, GAIN_VALUES[this->als_.gain], this->als_.itime_ms) * this->noise_factor_();
+  float ch1 = ch0 * this->ir_ratio_ * this->noise_factor_();
+  bool saturated = ch0 >= 65535.0f || ch1 >= 65535.0f;
+  uint16_t c0 = static_cast<uint16_t>(std::min(65535.0f, std::round(ch0)));
+  uint16_t c1 = static_cast<uint16_t>(std::min(65535.0f, std::round(ch1)));
+
+  this->regs_[idx(CommandRegisters::ALS_DATA_CH1_0)] = c1 & 0xFF;
+  this->regs_[idx(CommandRegisters::ALS_DATA_CH1_1)] = c1 >> 8;
+  this->regs_[idx(CommandRegisters::ALS_DATA_CH0_0)] = c0 & 0xFF;
+  this->regs_[idx(CommandRegisters::ALS_DATA_CH0_1)] = c0 >> 8;
+
+  AlsPsStatusRegister status{};
+  status.raw = this->regs_[idx(CommandRegisters::ALS_PS_STATUS)];
+  status.als_new_data = true;
+  status.gain = static_cast<AlsGain>(this->als_.gain);
+  status.data_invalid = this->invalid_after_range_change_ && this->als_.range_changed;
+
+  InterruptRegister intr{};
+  intr.raw = this->regs_[idx(CommandRegisters::ALS_PS_INTERRUPT)];
+  if (intr.als_interrupt) {
+    uint16_t up = this->regs_[idx(CommandRegisters::ALS_THRES_UP_0)] |
+                  (this->regs_[idx(CommandRegisters::ALS_THRES_UP_1)] << 8);
+    uint16_t low = this->regs_[idx(CommandRegisters::ALS_THRES_LOW_0)] |
+                   (this->regs_[idx(CommandRegisters::ALS_THRES_LOW_1)] << 8);
+    InterruptPersistRegister persist{};
+    persist.raw = this->regs_[idx(CommandRegisters::INTERRUPT_PERSIST)];
+    if (c0 > up || c0 < low) {
+      if (++this->als_.persist > persist.als_persist) {
+        status.als_interrupt = true;
+        this->set_int_(true);
+      }
+    } else {
+      this->als_.persist = 0;
+    }
+  }
+  this->regs_[idx(CommandRegisters::ALS_PS_STATUS)] = status.raw;
+
+  this->stats_.als_samples++;
+  if (saturated)
+    this->stats_.als_saturated++;
+}
+
+//
+// PS
+//
+void LtrChipSim::update_ps_(uint64_t now_us) {
+  while (this->ps_.active && this->ps_.next_us <= now_us) {
+    this->produce_ps_sample_(this->ps_.next_us);
+    PsMeasurementRateRegister rate{};
+    rate.raw = this->regs_[idx(CommandRegisters::PS_MEAS_RATE)];
+    this->ps_.next_us += uint64_t(PS_RATE_MS[rate.ps_measurement_rate]) * 1000;
+  }
+}
+
+void LtrChipSim::produce_ps_sample_(uint64_t at_us) {
+  PsLedRegister led{};
+  led.raw = this->regs_[idx(CommandRegisters::PS_LED)];
+  PsNPulsesRegister pulses{};
+  pulses.raw = this->regs_[idx(CommandRegisters::PS_N_PULSES)];
+  PsControlRegister ctrl{};
+  ctrl.raw = this->regs_[idx(CommandRegisters::PS_CONTR)];
+
+  // reflected signal scales with LED current, duty and number of pulses, relative to the reset defaults
+  float drive = LED_CURRENT_MA[led.ps_led_current] / 100.0f * (led.ps_led_duty + 1) / 4.0f * pulses.number_of_pulses;
+  float gain = ctrl.ps_gain == PS_GAIN_64 ? 4.0f : ctrl.ps_gain == PS_GAIN_32 ? 2.0f : 1.0f;
+  float counts = this->proximity_ ? this->proximity_(at_us / 1000) * drive * gain * this->noise_factor_() : 0.0f;
+  uint16_t offset = (this->regs_[idx(CommandRegisters::PS_OFFSET_1)] & 0x03) << 8 |
+                    this->regs_[idx(CommandRegisters::PS_OFFSET_0)];
+  counts = std::max(0.0f, std::round(counts) - offset);
+  bool saturated = counts > 2047.0f;
+  uint16_t ps = static_cast<uint16_t>(std::min(2047.0f, counts));
+
+  this->regs_[idx(CommandRegisters::PS_DATA_0)] = ps & 0xFF;
+  PsData1Register data1{};
+  data1.ps_data_high = ps >> 8;
+  data1.ps_saturation_flag = saturated && ctrl.ps_saturation_indicator_enable;
+  this->regs_[idx(CommandRegisters::PS_DATA_1)] = data1.raw;
+
+  AlsPsStatusRegister status{};
+  status.raw = this->regs_[idx(CommandRegisters::ALS_PS_STATUS)];
+  status.ps_new_data = true;
+
+  InterruptRegister intr{};
+  intr.raw = this->regs_[idx(CommandRegisters::ALS_PS_INTERRUPT)];
+  if (intr.ps_interrupt) {
+    uint16_t up = this->regs_[idx(CommandRegisters::PS_THRES_UP_0)] |
+                  (this->regs_[idx(CommandRegisters::PS_THRES_UP_1)] & 0x07) << 8;
+    uint16_t low = this->regs_[idx(CommandRegisters::PS_THRES_LOW_0)] |
+                   (this->regs_[idx(CommandRegisters::PS_THRES_LOW_1)] & 0x07) << 8;
+    InterruptPersistRegister persist{};
+    persist.raw = this->regs_[idx(CommandRegisters::INTERRUPT_PERSIST)];
+    if (ps > up || ps < low) {
+      if (++this->ps_.persist > persist.ps_persist) {
+        status.ps_interrupt = true;
+        this->set_int_(true);
+      }
+    } else {
+      this->ps_.persist = 0;
+    }
+  }
+  this->regs_[idx(CommandRegisters::ALS_PS_STATUS)] = status.raw;
+  this->stats_.ps_samples++;
+}
+
+//
+// Registers
+//
+void LtrChipSim::write_register_(uint8_t reg, uint8_t value) {
+  uint8_t i = reg & 0x7F;
+  uint64_t now = App.now_us();
+  this->stats_.register_writes++;
+
+  switch (static_cast<CommandRegisters>(reg)) {
+    case CommandRegisters::PART_ID:
+    case CommandRegisters::MANUFAC_ID:
+    case CommandRegisters::ALS_DATA_CH1_0:
+    case CommandRegisters::ALS_DATA_CH1_1:
+    case CommandRegisters::ALS_DATA_CH0_0:
+    case CommandRegisters::ALS_DATA_CH0_1:
+    case CommandRegisters::ALS_PS_STATUS:
+    case CommandRegisters::PS_DATA_0:
+    case CommandRegisters::PS_DATA_1:
+      return;  // read only
+
+    case CommandRegisters::ALS_CONTR: {
+      AlsControlRegister ctrl{};
+      ctrl.raw = value;
+      if (ctrl.sw_reset) {
+        // reset bit reads back as set until the chip finished its reset
+        this->stats_.resets++;
+        this->als_ = {};
+        this->ps_ = {};
+        this->regs_[i] = value;
+        this->reset_until_us_ = now + this->reset_time_us_;
+        return;
+      }
+      bool was_active = this->als_.active;
+      this->regs_[i] = value;
+      if (ctrl.active_mode && !was_active) {
+        this->als_ = {};
+        this->als_.active = true;
+        this->als_.start_us = now + ALS_WAKEUP_US;
+      } else if (!ctrl.active_mode) {
+        this->als_.active = false;  // cycle in progress is dropped
+      }
+      return;
+    }
+
+    case CommandRegisters::PS_CONTR: {
+      if (this->part_ == Part::LTR_303)
+        return;
+      PsControlRegister ctrl{};
+      ctrl.raw = value;
+      bool active = ctrl.ps_mode_xxx && ctrl.ps_mode_active;
+      this->regs_[i] = value;
+      if (active && !this->ps_.active) {
+        this->ps_.active = true;
+        this->ps_.next_us = now + PS_WAKEUP_US;
+      } else if (!active) {
+        this->ps_.active = false;
+      }
+      return;
+    }
+
+    case CommandRegisters::PS_LED:
+    case CommandRegisters::PS_N_PULSES:
+    case CommandRegisters::PS_MEAS_RATE:
+    case CommandRegisters::PS_THRES_UP_0:
+    case CommandRegisters::PS_THRES_UP_1:
+    case CommandRegisters::PS_THRES_LOW_0:
+    case CommandRegisters::PS_THRES_LOW_1:
+    case CommandRegisters::PS_OFFSET_1:
+    case CommandRegisters::PS_OFFSET_0:
+      if (this->part_ == Part::LTR_303)
+        return;
+      this->regs_[i] = value;
+      return;
+
+    default:
+      this->regs_[i] = value;
+      return;
+  }
+}
+
+ErrorCode LtrChipSim::write(const uint8_t *data, size_t len) {
+  if (len == 0)
+    return ErrorCode::ERROR_OK;
+  this->tick();
+  this->pointer_ = data[0];
+  if (this->reset_until_us_ != 0 && len > 1)
+    return ErrorCode::ERROR_NOT_ACKNOWLEDGED;  // busy resetting
+  for (size_t n = 1; n < len; n++)
+    this->write_register_(this->pointer_++, data[n]);
+  return ErrorCode::ERROR_OK;
+}
+
+ErrorCode LtrChipSim::read(uint8_t *data, size_t len) {
+  this->tick();
+  // Side effects apply byte by byte, the strict reading of the datasheet: new data bits read 0 once
+  // the data was read ("0 = old data"), so status read after the data in the same burst reports old data.
+  for (size_t n = 0; n < len; n++) {
+    uint8_t reg = this->pointer_++;
+    data[n] = reg >= 0x80 ? this->regs_[reg & 0x7F] : 0;
+    AlsPsStatusRegister status{};
+    status.raw = this->regs_[idx(CommandRegisters::ALS_PS_STATUS)];
+    switch (static_cast<CommandRegisters>(reg)) {
+      case CommandRegisters::ALS_DATA_CH1_0:
+      case CommandRegisters::ALS_DATA_CH1_1:
+      case CommandRegisters::ALS_DATA_CH0_0:
+      case CommandRegisters::ALS_DATA_CH0_1:
+        status.als_new_data = false;
+        break;
+      case CommandRegisters::PS_DATA_0:
+      case CommandRegisters::PS_DATA_1:
+        status.ps_new_data = false;
+        break;
+      case CommandRegisters::ALS_PS_STATUS:
+        status.als_interrupt = false;
+        status.ps_interrupt = false;
+        this->set_int_(false);
+        break;
+      default:
+        break;
+    }
+    this->regs_[idx(CommandRegisters::ALS_PS_STATUS)] = status.raw;
+  }
+  return ErrorCode::ERROR_OK;
+}
+
+//
+// Bus
+//
+LtrChipSim *SimBus::find_(uint8_t address) {
+  for (auto *chip : this->devices_) {
+    if (chip->get_address() == address)
+      return chip;
+  }
+  return nullptr;
+}
+
+void SimBus::spend_(size_t bytes) {
+  if (this->parent_ != nullptr) {
+    this->parent_->spend_(bytes);
+    return;
+  }
+  // start + address byte + data bytes, 9 clocks per byte with ACK, + stop
+  uint64_t bits = (bytes + 1) * 9 + 2;
+  uint64_t us = bits * 1000000 / this->frequency_hz_ + this->extra_latency_us_;
+  this->stats_.busy_us += us;
+  this->stats_.bytes += bytes;
+  App.advance_us(us);
+}
+
+void SimBus::count_transaction_() {
+  this->stats_.transactions++;
+  if (this->parent_ != nullptr)
+    this->parent_->stats_.transactions++;
+}
+
+void SimBus::select_channel_() {
+  if (this->parent_ == nullptr || this->parent_->selected_channel_ == this->channel_)
+    return;
+  this->parent_->selected_channel_ = this->channel_;
+  this->parent_->mux_switches_++;
+  this->parent_->stats_.transactions++;
+  this->parent_->spend_(1);
+}
+
+bool SimBus::nack_() {
+  this->operations_++;
+  if (this->nack_every_ != 0 && this->operations_ % this->nack_every_ == 0) {
+    this->stats_.errors++;
+    return true;
+  }
+  return false;
+}
+
+ErrorCode SimBus::write(uint8_t address, const uint8_t *data, size_t len, bool stop) {
+  // a register pointer write is the first half of a read, counted with the read
+  this->select_channel_();
+  if (len != 1)
+    this->count_transaction_();
+  this->spend_(len);
+  auto *chip = this->find_(address);
+  if (chip == nullptr || this->nack_())
+    return ErrorCode::ERROR_NOT_ACKNOWLEDGED;
+  if (len > 1 && data[0] == this->nack_reg_ && this->nack_reg_left_ > 0) {
+    this->nack_reg_left_--;
+    this->stats_.errors++;
+    return ErrorCode::ERROR_NOT_ACKNOWLEDGED;
+  }
+  return chip->write(data, len);
+}
+
+ErrorCode SimBus::read(uint8_t address, uint8_t *data, size_t len) {
+  this->select_channel_();
+  this->count_transaction_();
+  this->spend_(len);
+  auto *chip = this->find_(address);
+  if (chip == nullptr || this->nack_())
+    return ErrorCode::ERROR_NOT_ACKNOWLEDGED;
+  return chip->read(data, len);
+}
+
+}  // namespace ltr_sim
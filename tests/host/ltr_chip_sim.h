@@ -0,0 +1,173 @@
+#pragma once
+//
+// Register level simulator of LTR-303/329 and LTR-553/556/559 for host builds of the component.
+// Models what the driver depends on:
+//  - ALS and PS measurement cycles on virtual time, gain / integration time / repeat rate written
+//    mid-cycle take effect from the next cycle only, status register reports the gain of the data
+//  - new data bits, cleared by reading the data; interrupt bits and INT pin, released by reading status
+//  - saturation of both ALS channels (0xFFFF) and PS (0x7FF + saturation flag)
+//  - software reset, reset bit stays set for a while, registers go back to defaults
+//  - standby -> active wake up time
+//  - I2C timing at the bus clock plus injectable per transaction latency and NACKs
+//
+#include "esphome/components/i2c/i2c.h"
+#include "esphome/core/gpio.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace ltr_sim {
+
+using esphome::i2c::ErrorCode;
+
+class LtrChipSim {
+ public:
+  enum class Part { LTR_303, LTR_553 };
+
+  explicit LtrChipSim(Part part = Part::LTR_303);
+
+  uint8_t get_address() const { return this->address_; }
+  Part get_part() const { return this->part_; }
+
+  // Scene. Light is in lux as seen by the datasheet formula, IR ratio is CH1/CH0 (< 0.8 for valid lux).
+  // Proximity is in counts at the default LED drive (100 mA, 1 pulse, 100% duty), before PS_OFFSET.
+  void set_light(std::function<float(uint32_t ms)> lux, float ir_ratio = 0.25f) {
+    this->lux_ = std::move(lux);
+    this->ir_ratio_ = ir_ratio;
+  }
+  void set_proximity(std::function<float(uint32_t ms)> counts) { this->proximity_ = std::move(counts); }
+  void set_noise(float relative) { this->noise_ = relative; }  // uniform, +-relative of the counts
+  void set_int_pin(esphome::InternalGPIOPin *pin) { this->int_pin_ = pin; }
+  void set_reset_time_us(uint32_t us) { this->reset_time_us_ = us; }
+  void set_invalid_after_range_change(bool invalid) { this->invalid_after_range_change_ = invalid; }
+  // ALS keeps cycling but delivers no data in [from_ms, to_ms), like a chip that stopped latching
+  void set_als_dropout(uint32_t from_ms, uint32_t to_ms) {
+    this->als_dropout_from_ms_ = from_ms;
+    this->als_dropout_to_ms_ = to_ms;
+  }
+
+  // counts expected for the given light and range, without noise and saturation
+  static float lux_to_ch0(float lux, float ir_ratio, float gain, float itime_ms);
+
+  // Processes measurement cycles up to now. Called on every transaction, harness calls it
+  // between loop() passes too, so INT pin follows the chip even while the driver is idle.
+  void tick();
+
+  ErrorCode read(uint8_t *data, size_t len);
+  ErrorCode write(const uint8_t *data, size_t len);
+
+  struct Stats {
+    uint32_t als_samples{0};
+    uint32_t als_saturated{0};
+    uint32_t ps_samples{0};
+    uint32_t resets{0};
+    uint32_t register_writes{0};
+  };
+  const Stats &get_stats() const { return this->stats_; }
+  uint8_t peek(uint8_t reg) const { return this->regs_[reg & 0x7F]; }
+
+ protected:
+  void reset_registers_();
+  void write_register_(uint8_t reg, uint8_t value);
+  void update_als_(uint64_t now_us);
+  void update_ps_(uint64_t now_us);
+  void produce_als_sample_(uint64_t at_us);
+  void produce_ps_sample_(uint64_t at_us);
+  void set_int_(bool asserted);
+  float noise_factor_();
+
+  Part part_;
+  uint8_t address_;
+  uint8_t regs_[0x80]{};  // 0x80..0xFF, index is register & 0x7F
+  uint8_t pointer_{0x80};
+  Stats stats_;
+
+  std::function<float(uint32_t)> lux_;
+  float ir_ratio_{0.25f};
+  std::function<float(uint32_t)> proximity_;
+  float noise_{0.0f};
+  uint32_t noise_state_{1};
+  esphome::InternalGPIOPin *int_pin_{nullptr};
+  bool int_asserted_{false};
+
+  uint32_t reset_time_us_{1000};
+  uint64_t reset_until_us_{0};
+  bool invalid_after_range_change_{false};
+  uint32_t als_dropout_from_ms_{0};
+  uint32_t als_dropout_to_ms_{0};
+
+  struct AlsCycle {
+    bool active{false};
+    uint64_t start_us{0};
+    bool latched{false};
+    uint8_t gain{0};
+    uint16_t itime_ms{100};
+    uint16_t period_ms{500};
+    bool range_changed{false};
+    uint8_t last_gain{0};
+    uint16_t last_itime_ms{100};
+    uint8_t persist{0};
+  } als_;
+
+  struct PsCycle {
+    bool active{false};
+    uint64_t next_us{0};
+    uint8_t persist{0};
+  } ps_;
+};
+
+// Bus with any number of simulated chips. Every transfer advances virtual time by its duration.
+class SimBus : public esphome::i2c::I2CBus {
+ public:
+  explicit SimBus(uint32_t frequency_hz = 100000) : frequency_hz_(frequency_hz) {}
+  // Channel of a TCA9548A sitting on the parent bus: transfers go over the parent, switching
+  // channels costs a control register write to the mux. Parent statistics cover all channels,
+  // channel keeps only its own transaction count.
+  SimBus(SimBus *parent, uint8_t channel) : frequency_hz_(parent->frequency_hz_), parent_(parent), channel_(channel) {}
+
+  void add_device(LtrChipSim *chip) { this->devices_.push_back(chip); }
+  void set_extra_latency_us(uint32_t us) { this->extra_latency_us_ = us; }  // e.g. clock stretching
+  void set_nack_every(uint32_t n) { this->nack_every_ = n; }                // 0 - never
+  // NACK the next count writes to the register, e.g. to make the component give up on a queued write
+  void set_nack_writes_to(uint8_t reg, uint32_t count) {
+    this->nack_reg_ = reg;
+    this->nack_reg_left_ = count;
+  }
+
+  ErrorCode read(uint8_t address, uint8_t *data, size_t len) override;
+  ErrorCode write(uint8_t address, const uint8_t *data, size_t len, bool stop) override;
+
+  struct Stats {
+    uint32_t transactions{0};  // register pointer write + read counts as one
+    uint32_t bytes{0};
+    uint32_t errors{0};
+    uint64_t busy_us{0};
+  };
+  const Stats &get_stats() const { return this->stats_; }
+  void clear_stats() { this->stats_ = {}; }
+  uint32_t get_mux_switches() const { return this->mux_switches_; }
+
+ protected:
+  LtrChipSim *find_(uint8_t address);
+  void spend_(size_t bytes);
+  bool nack_();
+  void select_channel_();
+  void count_transaction_();
+
+  uint32_t frequency_hz_;
+  uint32_t extra_latency_us_{0};
+  uint32_t nack_every_{0};
+  uint32_t operations_{0};
+  uint8_t nack_reg_{0};
+  uint32_t nack_reg_left_{0};
+  std::vector<LtrChipSim *> devices_;
+  Stats stats_;
+
+  SimBus *parent_{nullptr};
+  uint8_t channel_{0};
+  int16_t selected_channel_{-1};  // on the parent
+  uint32_t mux_switches_{0};
+};
+
+}  // namespace ltr_sim
@@ -0,0 +1,173 @@
+//
+// Fixed point lux calculation against the floating point reference: every channel pair up to
+// 511 and a dense sweep of the whole 16 bit range across all IR ratios, for every gain and
+// integration time and a few glass factors. Reports worst relative error and ns per call.
+//
+#include "ltr_als_ps/ltr_als_ps.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+using namespace esphome::ltr_als_ps;
+
+namespace {
+
+// fixed point kernel is good to ~1e-4 (Q14 coefficients), allow for float rounding of the reference
+constexpr double MAX_RELATIVE_ERROR = 2e-4;
+
+const AlsGain GAINS[] = {GAIN_1, GAIN_2, GAIN_4, GAIN_8, GAIN_48, GAIN_96};
+
+class LuxProbe : public LTRAlsPsComponent {
+ public:
+  using LTRAlsPsComponent::AlsReadings;
+
+  void set_glass(float glass) {
+    this->glass_attenuation_factor_ = glass;
+    this->prepare_lux_scale_table_();
+  }
+  float fixed(const AlsReadings &in) {
+    AlsReadings data = in;
+    this->apply_lux_calculation_(data);
+    return data.lux;
+  }
+  float reference(const AlsReadings &in) {
+    AlsReadings data = in;
+    this->apply_lux_calculation_float_(data);
+    return data.lux;
+  }
+};
+
+using AlsReadings = LuxProbe::AlsReadings;
+
+struct Result {
+  uint64_t points{0};
+  uint64_t zero_mismatches{0};
+  double worst{0.0};
+  AlsReadings worst_at;
+};
+
+void compare(LuxProbe &probe, const AlsReadings &data, Result &result) {
+  float fixed = probe.fixed(data);
+  float reference = probe.reference(data);
+  result.points++;
+  if ((fixed == 0.0f) != (reference == 0.0f)) {
+    result.zero_mismatches++;
+    return;
+  }
+  if (reference == 0.0f)
+    return;
+  double error = std::fabs(double(fixed) - reference) / reference;
+  if (error > result.worst) {
+    result.worst = error;
+    result.worst_at = data;
+  }
+}
+
+template<typename F> void for_each_range(F &&f) {
+  for (auto gain : GAINS) {
+    for (uint8_t time = 0; time < TIMES_COUNT; time++) {
+      AlsReadings data;
+      data.gain = gain;
+      data.integration_time = static_cast<IntegrationTime>(time);
+      f(data);
+    }
+  }
+}
+
+bool report(const char *name, const Result &result) {
+  const auto &at = result.worst_at;
+  std::printf("  %-28s %10llu points, worst %.4f%% at ch0=%u ch1=%u gain %u time %u, zero mismatches %llu\n",
+              name, (unsigned long long) result.points, result.worst * 100, at.ch0, at.ch1, (uint32_t) at.gain,
+              (uint32_t) at.integration_time, (unsigned long long) result.zero_mismatches);
+  bool ok = result.worst <= MAX_RELATIVE_ERROR && result.zero_mismatches == 0;
+  if (!ok)
+    std::printf("FAIL %s\n", name);
+  return ok;
+}
+
+template<typename F> double ns_per_call(LuxProbe &probe, F &&kernel) {
+  AlsReadings data;
+  data.gain = GAIN_48;
+  data.integration_time = INTEGRATION_TIME_200MS;
+  volatile float sink = 0.0f;
+  uint32_t calls = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t ch0 = 1; ch0 < 65535; ch0 += 7) {
+    for (uint32_t k = 0; k < 32; k++) {
+      data.ch0 = ch0;
+      data.ch1 = ch0 * k / 40;  // ratio 0..0.44, the common branch
+      sink = sink + kernel(probe, data);
+      calls++;
+    }
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  return elapsed / calls;
+}
+
+}  // namespace
+
+int main() {
+  esphome::host::log_level = esphome::host::LOG_ERROR;  // saturation and impossible ratio warnings
+  LuxProbe probe;
+  bool ok = true;
+
+  probe.set_glass(1.0f);
+  Result small;
+  for_each_range([&](AlsReadings &data) {
+    for (uint32_t ch0 = 0; ch0 < 512; ch0++) {
+      for (uint32_t ch1 = 0; ch1 < 512; ch1++) {
+        data.ch0 = ch0;
+        data.ch1 = ch1;
+        compare(probe, data, small);
+      }
+    }
+  });
+  ok &= report("all pairs below 512", small);
+
+  // every 3rd CH0 over the full range, CH1 stepping through the ratio including the band edges
+  Result dense;
+  for_each_range([&](AlsReadings &data) {
+    for (uint32_t ch0 = 0; ch0 < 65535; ch0 += 3) {
+      for (uint32_t ratio_permille = 0; ratio_permille < 1000; ratio_permille += 25) {
+        uint32_t ch1 = ch0 * ratio_permille / (1000 - ratio_permille);
+        if (ch1 > 0xFFFF)
+          break;
+        data.ch0 = ch0;
+        data.ch1 = ch1;
+        compare(probe, data, dense);
+      }
+    }
+  });
+  ok &= report("full range, all ratios", dense);
+
+  for (float glass : {1.37f, 4.0f, 17.5f, 100.0f}) {
+    probe.set_glass(glass);
+    Result result;
+    for_each_range([&](AlsReadings &data) {
+      for (uint32_t ch0 = 1; ch0 < 65535; ch0 += 61) {
+        for (uint32_t ch1 = 0; ch1 <= 0xFFFE; ch1 += 257) {
+          data.ch0 = ch0;
+          data.ch1 = ch1;
+          compare(probe, data, result);
+        }
+      }
+    });
+    char name[40];
+    std::snprintf(name, sizeof(name), "glass factor %.2f", glass);
+    ok &= report(name, result);
+  }
+
+  probe.set_glass(1.0f);
+  double fixed_ns = ns_per_call(probe, [](LuxProbe &p, const AlsReadings &d) { return p.fixed(d); });
+  double float_ns = ns_per_call(probe, [](LuxProbe &p, const AlsReadings &d) { return p.reference(d); });
+  std::printf("  throughput: fixed point %.2f ns/call, floating point %.2f ns/call (host, not representative of\n"
+              "  soft float targets like ESP8266, run the benchmark on the device for those)\n",
+              fixed_ns, float_ns);
+
+  if (!ok)
+    return 1;
+  std::printf("all checks passed\n");
+  return 0;
+}
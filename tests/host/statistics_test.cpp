@@ -0,0 +1,110 @@
+//
+// Window statistics used by the streaming sensors: nearest-rank percentile from the log-linear
+// histogram, checked against exact nearest-rank over the whole window.
+//
+#include "ltr_als_ps/ltr_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using esphome::ltr_als_ps::LogHistogram;
+using esphome::ltr_als_ps::nearest_rank;
+
+namespace {
+
+int failures = 0;  // NOLINT
+
+void check(bool condition, const char *what) {
+  if (condition)
+    return;
+  std::printf("FAIL %s\n", what);
+  failures++;
+}
+
+uint32_t lcg = 1;  // NOLINT
+float uniform() {
+  lcg = lcg * 1664525u + 1013904223u;
+  return (lcg >> 8) / float(1u << 24);
+}
+
+void basics() {
+  LogHistogram<4, 11> histogram;
+  for (uint32_t v = 1; v <= 10; v++)
+    histogram.push(v);
+  check(nearest_rank(0.9f, 10) == 8, "rank of p90 of 10 samples");
+  check(histogram.percentile(0.9f) == 9, "p90 of 1..10 is 9");
+  check(histogram.percentile(1.0f) == 10, "p100 of 1..10 is 10");
+  check(histogram.percentile(0.0f) == 1, "p0 of 1..10 is 1");
+  check(histogram.percentile(0.5f) == 5, "median of 1..10 is the lower middle one");
+  histogram.clear();
+  histogram.push(7);
+  check(histogram.percentile(0.5f) == 7 && histogram.percentile(0.9f) == 7, "single sample");
+  histogram.clear();
+
+  check(histogram.percentile(0.5f) == 0, "empty histogram");
+  for (uint32_t v : {4, 1, 3, 2})
+    histogram.push(v);
+  check(histogram.percentile(0.5f) == 2, "histogram is exact below 16");
+  for (uint32_t v = 0; v < 100000; v++)
+    check(LogHistogram<4, 11>::bucket_of(std::min<uint32_t>(v, 2047)) < LogHistogram<4, 11>::BUCKETS, "bucket index");
+  histogram.clear();
+  for (int i = 0; i < 100000; i++)
+    histogram.push(i % 4 == 0 ? 1000 : 10);  // overflows a bucket, counts are halved
+  check(histogram.percentile(0.7f) == 10 && histogram.percentile(0.8f) > 900, "proportions kept after halving");
+}
+
+// Histogram of values in the given unit against exact nearest-rank of the raw samples
+template<uint8_t SUB_BITS, uint8_t MAX_BITS>
+void stream(const char *name, float p, size_t count, float unit, const std::function<float(size_t)> &source) {
+  LogHistogram<SUB_BITS, MAX_BITS> histogram;
+  std::vector<float> window;
+  for (size_t i = 0; i < count; i++) {
+    float x = source(i);
+    histogram.push(std::lround(x / unit));
+    window.push_back(x);
+  }
+  std::sort(window.begin(), window.end());
+  float exact = window[nearest_rank(p, window.size())];
+  float result = histogram.percentile(p) * unit;
+  // bucket half width plus rounding to the unit
+  float bound = exact / (2 << SUB_BITS) + unit;
+  std::printf("  %-20s p%-3.0f n=%6zu exact %10.3f histogram %10.3f  error %6.2f%%\n", name, p * 100, count, exact,
+              result, 100.0f * std::fabs(result - exact) / std::max(exact, unit));
+  check(std::fabs(result - exact) <= bound, name);
+}
+
+}  // namespace
+
+int main() {
+  basics();
+
+  // PS counts, 10 ms samples over a minute: noise around crosstalk, hand passes, slow drift
+  auto ps = stream<4, 11>;
+  ps("ps noise", 0.5f, 6000, 1.0f, [](size_t) { return std::round(80.0f + 10.0f * uniform()); });
+  ps("ps hand wave 20%", 0.5f, 6000, 1.0f,
+     [](size_t i) { return std::round((i % 1000 < 200 ? 1500.0f : 80.0f) + 6.0f * uniform()); });
+  ps("ps hand wave 70%", 0.5f, 6000, 1.0f,
+     [](size_t i) { return std::round((i % 1000 < 700 ? 1500.0f : 80.0f) + 6.0f * uniform()); });
+  ps("ps drift", 0.5f, 6000, 1.0f, [](size_t i) { return std::round(50.0f + i / 30.0f + 4.0f * uniform()); });
+  ps("ps short window", 0.5f, 12, 1.0f, [](size_t) { return std::round(300.0f * uniform()); });
+  ps("ps saturated", 0.9f, 600, 1.0f, [](size_t i) { return i % 3 ? 2047.0f : 900.0f; });
+
+  // lux in 0.01 lx units, 500 ms samples over the window: office, clouds, dusk, dark room
+  auto lux = stream<4, 26>;
+  lux("lux office", 0.9f, 120, 0.01f, [](size_t) { return 300.0f * (1.0f + 0.01f * uniform()); });
+  lux("lux clouds", 0.9f, 1800, 0.01f, [](size_t i) { return 20000.0f + 15000.0f * std::sin(i / 60.0f) * uniform(); });
+  lux("lux dusk", 0.9f, 7200, 0.01f, [](size_t i) { return 20000.0f * std::pow(0.5f / 20000.0f, i / 7200.0f); });
+  lux("lux dark room", 0.5f, 120, 0.01f, [](size_t) { return 0.05f + 0.02f * uniform(); });
+  lux("lux sunlight", 0.9f, 120, 0.01f, [](size_t) { return 90000.0f + 30000.0f * uniform(); });
+
+  if (failures > 0) {
+    std::printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace binary_sensor {
+
+class BinarySensor {
+ public:
+  explicit BinarySensor(std::string name = "") : name_(std::move(name)) {}
+
+  void publish_state(bool state);
+  void publish_initial_state(bool state) { this->state = state; }
+  const std::string &get_name() const { return this->name_; }
+
+  bool state{false};
+
+  // host harness only
+  struct Publish {
+    uint32_t ms;
+    bool value;
+  };
+  const std::vector<Publish> &get_history() const { return this->history_; }
+
+ protected:
+  std::string name_;
+  std::vector<Publish> history_;
+};
+
+}  // namespace binary_sensor
+}  // namespace esphome
+
+#define LOG_BINARY_SENSOR(prefix, type, obj) \
+  if ((obj) != nullptr) \
+  ESP_LOGCONFIG(TAG, "%s%s '%s'", prefix, type, (obj)->get_name().c_str())
@@ -0,0 +1,49 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace sensor {
+
+// Host build: no filters, every published value is recorded with its virtual timestamp
+class Sensor {
+ public:
+  explicit Sensor(std::string name = "") : name_(std::move(name)) {}
+
+  void publish_state(float state);
+  float get_state() const { return this->state_; }
+  float get_raw_state() const { return this->state_; }
+  bool has_state() const { return this->has_state_; }
+  const std::string &get_name() const { return this->name_; }
+  void set_name(const std::string &name) { this->name_ = name; }
+  void add_on_state_callback(std::function<void(float)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+
+  // host harness only
+  struct Publish {
+    uint32_t ms;
+    float value;
+  };
+  const std::vector<Publish> &get_history() const { return this->history_; }
+  void clear_history() { this->history_.clear(); }
+
+ protected:
+  std::string name_;
+  float state_{NAN};
+  bool has_state_{false};
+  std::vector<std::function<void(float)>> callbacks_;
+  std::vector<Publish> history_;
+};
+
+}  // namespace sensor
+}  // namespace esphome
+
+#define LOG_SENSOR(prefix, type, obj) \
+  if ((obj) != nullptr) \
+  ESP_LOGCONFIG(TAG, "%s%s '%s'", prefix, type, (obj)->get_name().c_str())
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor {
+ public:
+  explicit TextSensor(std::string name = "") : name_(std::move(name)) {}
+
+  void publish_state(const std::string &state);
+  const std::string &get_name() const { return this->name_; }
+
+  std::string state;
+
+  // host harness only
+  struct Publish {
+    uint32_t ms;
+    std::string value;
+  };
+  const std::vector<Publish> &get_history() const { return this->history_; }
+
+ protected:
+  std::string name_;
+  std::vector<Publish> history_;
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
+
+#define LOG_TEXT_SENSOR(prefix, type, obj) \
+  if ((obj) != nullptr) \
+  ESP_LOGCONFIG(TAG, "%s%s '%s'", prefix, type, (obj)->get_name().c_str())
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+
+// Host build of the main loop. Time is virtual: it advances by the loop() pace between passes and
+// by whatever the simulated I2C bus reports for each transaction, so bus latency shows up in
+// millis()/micros() exactly where the firmware would block.
+class Application {
+ public:
+  void register_component(Component *component) { this->components_.push_back(component); }
+  void setup();
+  void loop();
+  // Runs loop() passes until virtual time reaches the given point, calls hook after each pass
+  void run_until(uint32_t ms, const std::function<void()> &hook = nullptr);
+  uint32_t get_loop_component_start_time() const { return this->loop_component_start_time_; }
+
+  // host harness only
+  // keep_preferences: like a reboot, new component instances see what the previous ones saved
+  void reset(bool keep_preferences = false);
+  void advance_us(uint64_t us) { this->now_us_ += us; }
+  uint64_t now_us() const { return this->now_us_; }
+  void set_loop_interval(uint32_t ms) { this->loop_interval_ms_ = ms; }
+  // per component loop() wrapper, e.g. to time it
+  void set_loop_wrapper(std::function<void(Component *)> &&wrapper) { this->loop_wrapper_ = std::move(wrapper); }
+
+  // scheduler
+  void set_timer(Component *component, const std::string &name, uint32_t delay, uint32_t interval,
+                 std::function<void()> &&f);
+  bool cancel_timer(Component *component, const std::string &name, bool interval);
+
+ protected:
+  struct Timer {
+    Component *component;
+    std::string name;
+    uint64_t next_us;
+    uint32_t interval_ms;  // 0 - timeout
+    std::function<void()> f;
+    bool removed;
+  };
+  void run_scheduler_();
+
+  std::vector<Component *> components_;
+  std::vector<Timer> timers_;
+  uint64_t now_us_{0};
+  uint32_t loop_interval_ms_{16};
+  uint32_t loop_component_start_time_{0};
+  std::function<void(Component *)> loop_wrapper_;
+};
+
+extern Application App;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+}  // namespace esphome
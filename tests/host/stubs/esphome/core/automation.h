@@ -0,0 +1,33 @@
+#pragma once
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace esphome {
+
+template<typename... Ts> class CallbackManager;
+
+template<typename... Ts> class CallbackManager<void(Ts...)> {
+ public:
+  void add(std::function<void(Ts...)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+  void call(Ts... args) {
+    for (auto &cb : this->callbacks_)
+      cb(args...);
+  }
+  size_t size() const { return this->callbacks_.size(); }
+
+ protected:
+  std::vector<std::function<void(Ts...)>> callbacks_;
+};
+
+// Host build: automations are not built, triggers count their firings for the harness
+template<typename... Ts> class Trigger {
+ public:
+  void trigger(Ts... x) { this->count_++; }
+  uint32_t get_count() const { return this->count_; }
+
+ protected:
+  uint32_t count_{0};
+};
+
+}  // namespace esphome
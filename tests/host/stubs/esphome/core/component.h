@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+
+namespace esphome {
+
+namespace setup_priority {
+extern const float HARDWARE;
+extern const float DATA;
+}  // namespace setup_priority
+
+// Host build of the ESPHome component model. Timers go to the scheduler in application.h,
+// which runs them on virtual time the same way as the firmware does between loop() passes.
+class Component {
+ public:
+  virtual ~Component() = default;
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const { return setup_priority::DATA; }
+  virtual void call_setup() { this->setup(); }
+
+  bool is_ready() const { return this->state_ == STATE_SETUP || this->state_ == STATE_LOOP; }
+  bool is_failed() const { return this->state_ == STATE_FAILED; }
+  void mark_failed();
+  void status_set_warning() { this->warning_ = true; }
+  void status_clear_warning() { this->warning_ = false; }
+  bool status_has_warning() const { return this->warning_; }
+
+  // host harness only
+  void set_component_state_setup() { this->state_ = STATE_SETUP; }
+  void set_component_state_loop() {
+    if (this->state_ != STATE_FAILED)
+      this->state_ = STATE_LOOP;
+  }
+
+ protected:
+  void set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f);
+  void set_timeout(uint32_t timeout, std::function<void()> &&f);
+  bool cancel_timeout(const std::string &name);
+  void set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f);
+  void set_interval(uint32_t interval, std::function<void()> &&f);
+  bool cancel_interval(const std::string &name);
+
+  enum ComponentState : uint8_t { STATE_CONSTRUCTION, STATE_SETUP, STATE_LOOP, STATE_FAILED } state_{STATE_CONSTRUCTION};
+  bool warning_{false};
+};
+
+class PollingComponent : public Component {
+ public:
+  PollingComponent() = default;
+  explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+
+  virtual void update() = 0;
+  void call_setup() override;
+  virtual void set_update_interval(uint32_t update_interval) { this->update_interval_ = update_interval; }
+  virtual uint32_t get_update_interval() const { return this->update_interval_; }
+  void start_poller();
+  void stop_poller();
+
+ protected:
+  uint32_t update_interval_{60000};
+};
+
+}  // namespace esphome
@@ -0,0 +1,2 @@
+#pragma once
+// Host build: USE_LTR_* feature defines come from the build system, one set per target
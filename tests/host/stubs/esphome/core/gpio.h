@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+
+namespace gpio {
+enum InterruptType : uint8_t {
+  INTERRUPT_RISING_EDGE = 1,
+  INTERRUPT_FALLING_EDGE = 2,
+  INTERRUPT_ANY_EDGE = 3,
+  INTERRUPT_LOW_LEVEL = 4,
+  INTERRUPT_HIGH_LEVEL = 5,
+};
+}  // namespace gpio
+
+class GPIOPin {
+ public:
+  virtual ~GPIOPin() = default;
+  virtual void setup() = 0;
+  virtual bool digital_read() = 0;
+  virtual void digital_write(bool value) = 0;
+  virtual std::string dump_summary() const = 0;
+};
+
+// Host pin: the harness drives the level, falling/rising edges call the attached handler
+class InternalGPIOPin : public GPIOPin {
+ public:
+  void setup() override {}
+  bool digital_read() override { return this->level_; }
+  void digital_write(bool value) override;
+  std::string dump_summary() const override { return "host pin"; }
+
+  template<typename T> void attach_interrupt(void (*func)(T *), T *arg, gpio::InterruptType type) const {
+    this->attach_interrupt_(reinterpret_cast<void (*)(void *)>(func), arg, type);
+  }
+  void detach_interrupt() const { this->isr_ = nullptr; }
+
+ protected:
+  void attach_interrupt_(void (*func)(void *), void *arg, gpio::InterruptType type) const {
+    this->isr_ = func;
+    this->isr_arg_ = arg;
+    this->isr_type_ = type;
+  }
+
+  bool level_{true};
+  mutable void (*isr_)(void *){nullptr};
+  mutable void *isr_arg_{nullptr};
+  mutable gpio::InterruptType isr_type_{gpio::INTERRUPT_ANY_EDGE};
+};
+
+}  // namespace esphome
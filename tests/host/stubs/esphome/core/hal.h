@@ -0,0 +1,15 @@
+#pragma once
+// Host build: time is virtual, driven by the harness (see application.h)
+#include <cstdint>
+#include "esphome/core/gpio.h"
+
+#define IRAM_ATTR
+
+namespace esphome {
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+}  // namespace esphome
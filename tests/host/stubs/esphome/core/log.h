@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdio>
+#include <functional>
+
+namespace esphome {
+namespace host {
+enum LogLevel : int { LOG_NONE = 0, LOG_ERROR, LOG_WARN, LOG_INFO, LOG_CONFIG, LOG_DEBUG, LOG_VERBOSE, LOG_VERY_VERBOSE };
+extern int log_level;  // set by the harness, WARN by default
+// when set, gets every message that passes log_level instead of stdout, e.g. to capture trace lines
+extern std::function<void(int level, const char *tag, const char *message)> log_listener;
+void log_printf(int level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+}  // namespace host
+}  // namespace esphome
+
+#define ESP_LOG_AT_(level, tag, ...) \
+  do { \
+    if (::esphome::host::log_level >= (level)) \
+      ::esphome::host::log_printf(level, tag, __VA_ARGS__); \
+  } while (0)
+
+#define ESP_LOGE(tag, ...) ESP_LOG_AT_(::esphome::host::LOG_ERROR, tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ESP_LOG_AT_(::esphome::host::LOG_WARN, tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ESP_LOG_AT_(::esphome::host::LOG_INFO, tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ESP_LOG_AT_(::esphome::host::LOG_CONFIG, tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ESP_LOG_AT_(::esphome::host::LOG_DEBUG, tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ESP_LOG_AT_(::esphome::host::LOG_VERBOSE, tag, __VA_ARGS__)
+#define ESP_LOGVV(tag, ...) ESP_LOG_AT_(::esphome::host::LOG_VERY_VERBOSE, tag, __VA_ARGS__)
+
+#define ONOFF(b) ((b) ? "ON" : "OFF")
+#define YESNO(b) ((b) ? "YES" : "NO")
+
+#define LOG_UPDATE_INTERVAL(this) ESP_LOGCONFIG(TAG, "  Update Interval: %.1fs", this->get_update_interval() / 1000.0f)
+#define LOG_PIN(prefix, pin) \
+  if ((pin) != nullptr) \
+  ESP_LOGCONFIG(TAG, "%s%s", prefix, (pin)->dump_summary().c_str())
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace esphome {
+
+// Host build: preferences live in memory for the lifetime of the process, so a restarted
+// component (new instance, same key) sees what the previous one saved - like a reboot
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() = default;
+  explicit ESPPreferenceObject(std::vector<uint8_t> *slot) : slot_(slot) {}
+
+  template<typename T> bool save(const T *src) {
+    if (this->slot_ == nullptr)
+      return false;
+    this->slot_->assign(reinterpret_cast<const uint8_t *>(src), reinterpret_cast<const uint8_t *>(src) + sizeof(T));
+    return true;
+  }
+  template<typename T> bool load(T *dest) {
+    if (this->slot_ == nullptr || this->slot_->size() != sizeof(T))
+      return false;
+    std::memcpy(dest, this->slot_->data(), sizeof(T));
+    return true;
+  }
+
+ protected:
+  std::vector<uint8_t> *slot_{nullptr};
+};
+
+class ESPPreferences {
+ public:
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash = false) {
+    return ESPPreferenceObject(&this->storage_[type]);
+  }
+  void clear() { this->storage_.clear(); }
+
+ protected:
+  std::map<uint32_t, std::vector<uint8_t>> storage_;
+};
+
+extern ESPPreferences *global_preferences;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+}  // namespace esphome
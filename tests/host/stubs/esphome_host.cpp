@@ -0,0 +1,283 @@
+// Host implementation of the ESPHome core pieces used by the component: virtual clock,
+// scheduler, main loop, preferences and logging.
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
+#include "esphome/core/application.h"
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <string>
+
+namespace esphome {
+
+Application App;                                // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+static ESPPreferences host_preferences;         // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+ESPPreferences *global_preferences = &host_preferences;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+namespace setup_priority {
+const float HARDWARE = 800.0f;
+const float DATA = 600.0f;
+}  // namespace setup_priority
+
+namespace host {
+int log_level = LOG_WARN;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+std::function<void(int, const char *, const char *)> log_listener;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+void log_printf(int level, const char *tag, const char *format, ...) {
+  static const char LETTERS[] = "-EWICDVV";
+  va_list args;
+  va_start(args, format);
+  int length = std::vsnprintf(nullptr, 0, format, args);
+  va_end(args);
+  std::string message(length, '\0');
+  va_start(args, format);
+  std::vsnprintf(&message[0], length + 1, format, args);
+  va_end(args);
+  if (log_listener) {
+    log_listener(level, tag, message.c_str());
+    return;
+  }
+  std::printf("[%9.3f][%c][%s] %s\n", App.now_us() / 1e6, LETTERS[level], tag, message.c_str());
+}
+}  // namespace host
+
+//
+// Time
+//
+uint32_t millis() { return App.now_us() / 1000; }
+uint32_t micros() { return App.now_us(); }
+void delay(uint32_t ms) { App.advance_us(uint64_t(ms) * 1000); }
+void delayMicroseconds(uint32_t us) { App.advance_us(us); }
+
+//
+// Helpers
+//
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+
+// deterministic, runs must be reproducible; restarts with every Application::reset()
+static uint32_t random_state = 12345;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+uint32_t random_uint32() {
+  random_state = random_state * 1664525u + 1013904223u;
+  return random_state;
+}
+
+std::string format_hex(const uint8_t *data, size_t length) {
+  static const char HEX_CHARS[] = "0123456789abcdef";
+  std::string ret;
+  ret.resize(length * 2);
+  for (size_t i = 0; i < length; i++) {
+    ret[2 * i] = HEX_CHARS[data[i] >> 4];
+    ret[2 * i + 1] = HEX_CHARS[data[i] & 0x0F];
+  }
+  return ret;
+}
+
+uint32_t HighFrequencyLoopRequester::num_requests = 0;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+void HighFrequencyLoopRequester::start() {
+  if (this->started_)
+    return;
+  num_requests++;
+  this->started_ = true;
+}
+
+void HighFrequencyLoopRequester::stop() {
+  if (!this->started_)
+    return;
+  num_requests--;
+  this->started_ = false;
+}
+
+bool HighFrequencyLoopRequester::is_high_frequency() { return num_requests > 0; }
+
+//
+// Pins
+//
+void InternalGPIOPin::digital_write(bool value) {
+  bool previous = this->level_;
+  this->level_ = value;
+  if (this->isr_ == nullptr || previous == value)
+    return;
+  bool falling = previous && !value;
+  if ((falling && this->isr_type_ != gpio::INTERRUPT_RISING_EDGE) ||
+      (!falling && this->isr_type_ != gpio::INTERRUPT_FALLING_EDGE))
+    this->isr_(this->isr_arg_);
+}
+
+//
+// Entities
+//
+namespace sensor {
+void Sensor::publish_state(float state) {
+  this->state_ = state;
+  this->has_state_ = true;
+  this->history_.push_back({millis(), state});
+  for (auto &cb : this->callbacks_)
+    cb(state);
+}
+}  // namespace sensor
+
+namespace binary_sensor {
+void BinarySensor::publish_state(bool state) {
+  this->state = state;
+  this->history_.push_back({millis(), state});
+}
+}  // namespace binary_sensor
+
+namespace text_sensor {
+void TextSensor::publish_state(const std::string &state) {
+  this->state = state;
+  this->history_.push_back({millis(), state});
+}
+}  // namespace text_sensor
+
+//
+// Components
+//
+void Component::mark_failed() {
+  ESP_LOGE("component", "Component was marked as failed");
+  this->state_ = STATE_FAILED;
+}
+
+void Component::set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f) {
+  App.set_timer(this, name, timeout, 0, std::move(f));
+}
+
+void Component::set_timeout(uint32_t timeout, std::function<void()> &&f) {
+  App.set_timer(this, "", timeout, 0, std::move(f));
+}
+
+bool Component::cancel_timeout(const std::string &name) { return App.cancel_timer(this, name, false); }
+
+void Component::set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f) {
+  // like the firmware, the first run goes at a random offset within the first half of the interval
+  uint32_t offset = interval != 0 ? (random_uint32() % interval) / 2 : 0;
+  App.set_timer(this, name, offset, interval, std::move(f));
+}
+
+void Component::set_interval(uint32_t interval, std::function<void()> &&f) { this->set_interval("", interval, std::move(f)); }
+
+bool Component::cancel_interval(const std::string &name) { return App.cancel_timer(this, name, true); }
+
+void PollingComponent::call_setup() {
+  this->setup();
+  this->start_poller();
+}
+
+void PollingComponent::start_poller() { this->set_interval("update", this->get_update_interval(), [this]() { this->update(); }); }
+
+void PollingComponent::stop_poller() { this->cancel_interval("update"); }
+
+//
+// Main loop and scheduler
+//
+void Application::reset(bool keep_preferences) {
+  this->components_.clear();
+  this->timers_.clear();
+  this->now_us_ = 0;
+  this->loop_wrapper_ = nullptr;
+  if (!keep_preferences)
+    host_preferences.clear();
+  random_state = 12345;
+}
+
+void Application::setup() {
+  std::stable_sort(this->components_.begin(), this->components_.end(), [](Component *a, Component *b) {
+    return a->get_setup_priority() > b->get_setup_priority();
+  });
+  for (auto *component : this->components_) {
+    component->set_component_state_setup();
+    component->call_setup();
+    component->set_component_state_loop();
+  }
+}
+
+void Application::set_timer(Component *component, const std::string &name, uint32_t delay, uint32_t interval,
+                            std::function<void()> &&f) {
+  if (!name.empty())
+    this->cancel_timer(component, name, interval != 0);
+  this->timers_.push_back({component, name, this->now_us_ + uint64_t(delay) * 1000, interval, std::move(f), false});
+}
+
+bool Application::cancel_timer(Component *component, const std::string &name, bool interval) {
+  bool found = false;
+  for (auto &timer : this->timers_) {
+    if (!timer.removed && timer.component == component && timer.name == name && (timer.interval_ms != 0) == interval) {
+      timer.removed = true;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void Application::run_scheduler_() {
+  while (true) {
+    // earliest due timer first, callbacks may add or cancel timers
+    size_t due = this->timers_.size();
+    for (size_t i = 0; i < this->timers_.size(); i++) {
+      const auto &timer = this->timers_[i];
+      if (timer.removed || timer.next_us > this->now_us_)
+        continue;
+      if (due == this->timers_.size() || timer.next_us < this->timers_[due].next_us)
+        due = i;
+    }
+    if (due == this->timers_.size())
+      break;
+
+    std::function<void()> f;
+    if (this->timers_[due].interval_ms == 0) {
+      f = std::move(this->timers_[due].f);
+      this->timers_[due].removed = true;
+    } else {
+      f = this->timers_[due].f;
+      this->timers_[due].next_us += uint64_t(this->timers_[due].interval_ms) * 1000;
+    }
+    if (!this->timers_[due].component->is_failed())
+      f();
+  }
+  this->timers_.erase(std::remove_if(this->timers_.begin(), this->timers_.end(), [](const Timer &t) { return t.removed; }),
+                      this->timers_.end());
+}
+
+void Application::loop() {
+  uint64_t started = this->now_us_;
+  this->run_scheduler_();
+  for (auto *component : this->components_) {
+    if (component->is_failed())
+      continue;
+    this->loop_component_start_time_ = millis();
+    if (this->loop_wrapper_) {
+      this->loop_wrapper_(component);
+    } else {
+      component->loop();
+    }
+  }
+  // firmware sleeps the rest of the loop interval unless somebody asked for high frequency loop
+  uint64_t pace_us = HighFrequencyLoopRequester::is_high_frequency() ? 1000 : uint64_t(this->loop_interval_ms_) * 1000;
+  this->now_us_ = std::max(this->now_us_, started + pace_us);
+}
+
+void Application::run_until(uint32_t ms, const std::function<void()> &hook) {
+  while (this->now_us_ < uint64_t(ms) * 1000) {
+    this->loop();
+    if (hook)
+      hook();
+  }
+}
+
+}  // namespace esphome